@@ -0,0 +1,47 @@
+#include "backend.h"
+#include "sat.h"
+
+#include <stdexcept>
+
+struct SearchBackend : Backend {
+    const char* name() const override { return "search"; }
+    bool solve(Schedule& schedule, const SearchOptions& options) override { return scheduler(schedule, options); }
+};
+
+struct SatBackend : Backend {
+    const char* name() const override { return "sat"; }
+
+    bool solve(Schedule& schedule, const SearchOptions& options) override {
+        if (options.optimize || options.lns > 0)
+            throw std::invalid_argument("the sat backend does not optimize");
+        if (options.solutions > 0)
+            throw std::invalid_argument("the sat backend does not enumerate");
+
+        std::vector<bool> model;
+        int result = solve_cnf(encode(schedule), model, options, options.stats);
+        if (options.complete)
+            *options.complete = result != -1;
+        if (result != 1)
+            return false;
+
+        // remove the option the model does not take, for every undecided day
+        schedule.recount_cost();
+        for (int w = 0; w < (int)schedule.workers.size(); w++) {
+            Domain& domain = schedule.workers[w].domain;
+            for (Days open = domain.on & domain.off; open; open &= open - 1) {
+                int day = first_day(open);
+                schedule.remove(w, day, !model[duty_variable(schedule, w, day)]);
+            }
+        }
+        schedule.clear_queue();
+        return true;
+    }
+};
+
+std::unique_ptr<Backend> make_backend(const std::string& name) {
+    if (name == "search")
+        return std::make_unique<SearchBackend>();
+    if (name == "sat")
+        return std::make_unique<SatBackend>();
+    throw std::invalid_argument("unknown backend " + name);
+}
@@ -0,0 +1,24 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "scheduler.h"
+
+#include <memory>
+
+/// A solver of the model built by load_file. It decides every day of every worker of the schedule
+/// and returns true, or returns false when there is no solution (or it was stopped first).
+struct Backend {
+    virtual ~Backend() = default;
+    virtual const char* name() const = 0;
+    virtual bool solve(Schedule& schedule, const SearchOptions& options) = 0;
+};
+
+/// Return the backend of the given name:
+///                 search: scheduler(), the constraint propagating search, with every option
+///                 sat:    the schedule encoded as clauses (see encode()) and solved by the clause learning
+///                         solver of sat.h. It finds a first schedule only: it rejects -optimize, -lns,
+///                         -solutions and -count
+/// Unknown names throw a std::invalid_argument.
+std::unique_ptr<Backend> make_backend(const std::string& name);
+
+#endif // BACKEND_H
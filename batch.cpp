@@ -0,0 +1,96 @@
+#include "batch.h"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> batch_inputs(const std::string& path) {
+    std::vector<std::string> inputs;
+    if (fs::is_directory(path)) {
+        for (auto& entry : fs::directory_iterator(path))
+            if (entry.is_regular_file() && entry.path().extension() != ".out")
+                inputs.push_back(entry.path().string());
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("cannot open " + path);
+    fs::path base = fs::path(path).parent_path();
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        fs::path input = line.substr(start, end - start + 1);
+        inputs.push_back(input.is_absolute() ? input.string() : (base / input).string());
+    }
+    return inputs;
+}
+
+/// Read, solve and write one instance
+static void solve_instance(BatchResult& result, const std::string& output_dir, const std::string& backend,
+                           const SearchOptions& options) {
+    auto start_time = std::chrono::steady_clock::now();
+    fs::path input = result.input;
+    result.output = output_dir.empty() ? result.input + ".out"
+                                       : (fs::path(output_dir) / input.filename()).string() + ".out";
+    try {
+        Schedule schedule = load_file(result.input);
+        bool complete = false;
+        SearchOptions local = options;
+        local.complete = &complete;
+        result.solved = make_backend(backend)->solve(schedule, local);
+        result.cost = schedule.cost;
+
+        std::ofstream out(result.output);
+        if (result.solved) {
+            schedule.write(out);
+            out << std::endl;
+            if (options.optimize || options.lns > 0)
+                out << "Cost: " << schedule.cost << (complete ? " (optimal)" : "") << std::endl;
+        }
+        else
+            out << (complete ? "No solution found." : "No solution found within the limits.") << std::endl;
+        result.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        out << "Duration: " << result.milliseconds << " ms" << std::endl;
+    }
+    catch (const std::exception& e) {
+        result.error = e.what();
+        result.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+    }
+}
+
+std::vector<BatchResult> solve_batch(const std::vector<std::string>& inputs, const std::string& output_dir,
+                                     int jobs, const std::string& backend, const SearchOptions& options) {
+    std::vector<BatchResult> results(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+        results[i].input = inputs[i];
+    if (!output_dir.empty())
+        fs::create_directories(output_dir);
+
+    // the instances are the parallelism: each search runs single threaded, reporting nothing
+    SearchOptions local = options;
+    local.threads = 1;
+    local.stats = nullptr;
+    local.on_solution = nullptr;
+
+    // the threads take the next instance until none is left
+    std::atomic<size_t> next { 0 };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, jobs); t++) {
+        pool.emplace_back([&]() {
+            for (size_t i = next++; i < results.size(); i = next++)
+                solve_instance(results[i], output_dir, backend, local);
+        });
+    }
+    for (auto& thread : pool)
+        thread.join();
+    return results;
+}
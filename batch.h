@@ -0,0 +1,29 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "scheduler.h"
+#include "backend.h"
+
+/// Outcome of one instance of a batch
+struct BatchResult {
+    std::string input;           // input file
+    std::string output;          // file its schedule was written to
+    std::string error;           // why the instance could not be read, empty otherwise
+    bool solved = false;         // a schedule was found
+    long long cost = 0;          // cost of the schedule
+    long long milliseconds = 0;  // reading, solving and writing the instance
+};
+
+/// List the input files of a batch: the regular files of a directory in name order (but the .out files),
+/// or else the lines of a manifest file, relative to the manifest's directory.
+/// Blank lines and lines starting with # are skipped.
+std::vector<std::string> batch_inputs(const std::string& path);
+
+/// Solve every input file with a pool of jobs threads. The instances share nothing: each one is read,
+/// solved by a single threaded search of the named backend (see make_backend()) and written by the thread that takes it.
+/// The schedule and duration of an instance are written to output_dir/<input file name>.out,
+/// or next to the input when output_dir is empty. The results are in the order of the inputs.
+std::vector<BatchResult> solve_batch(const std::vector<std::string>& inputs, const std::string& output_dir,
+                                     int jobs, const std::string& backend, const SearchOptions& options);
+
+#endif // BATCH_H
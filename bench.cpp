@@ -0,0 +1,162 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "scheduler.h"
+#include "generator.h"
+#include "backend.h"
+
+using namespace std;
+
+/// Measurements of one instance, filled by the child process that solved it
+struct Measure {
+    string result = "ERROR";
+    long long load_ms = 0, solve_ms = 0, nodes = 0, backtracks = 0;
+    long peak_kb = 0;
+};
+
+/// Load and solve the instance in a child process, so that its peak memory can be measured on its own
+/// and a run exceeding the timeout can be killed.
+static Measure run(const string& filename, const string& backend, const SearchOptions& options, int timeout) {
+    Measure m;
+    int fd[2];
+    if (pipe(fd) != 0)
+        return m;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        alarm(timeout);
+
+        auto start_time = chrono::steady_clock::now();
+        Schedule schedule = load_file(filename);
+        auto load_time = chrono::steady_clock::now();
+        Stats stats;
+        SearchOptions local = options;
+        local.stats = &stats;
+        bool success = make_backend(backend)->solve(schedule, local);
+        auto end_time = chrono::steady_clock::now();
+
+        char line[256];
+        int n = snprintf(line, sizeof(line), "%s %lld %lld %lld %lld\n", success ? "SAT" : "UNSAT",
+                         (long long)chrono::duration_cast<chrono::milliseconds>(load_time - start_time).count(),
+                         (long long)chrono::duration_cast<chrono::milliseconds>(end_time - load_time).count(),
+                         stats.nodes, stats.backtracks);
+        if (write(fd[1], line, n) != n)
+            _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+
+    string output;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(fd[0], buffer, sizeof(buffer))) > 0)
+        output.append(buffer, n);
+    close(fd[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    m.peak_kb = usage.ru_maxrss;
+
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+        m.result = "TIMEOUT";
+    else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        char result[16];
+        sscanf(output.c_str(), "%15s %lld %lld %lld %lld", result, &m.load_ms, &m.solve_ms, &m.nodes, &m.backtracks);
+        m.result = result;
+    }
+    return m;
+}
+
+/// parse a comma separated list of worker counts
+static vector<int> parse_sizes(const string& list) {
+    vector<int> sizes;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ','))
+        sizes.push_back(stoi(item));
+    return sizes;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions generator;
+    SearchOptions options;
+    vector<int> sizes = { 10, 100, 1000, 10000 };
+    string gen_file = "";
+    string backend = "search";
+    int timeout = 60;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (i + 1 >= argc)
+                throw invalid_argument("missing value for " + arg);
+
+            if (arg == "-gen") gen_file = argv[++i];
+            else if (arg == "-workers") sizes = parse_sizes(argv[++i]);
+            else if (arg == "-senior-ratio") generator.senior_ratio = stod(argv[++i]);
+            else if (arg == "-conflict-density") generator.conflict_density = stod(argv[++i]);
+            else if (arg == "-conflict-size") generator.conflict_size = stoi(argv[++i]);
+            else if (arg == "-tightness") generator.tightness = stod(argv[++i]);
+            else if (arg == "-weeks") generator.weeks = stoi(argv[++i]);
+            else if (arg == "-min-days-off") generator.min_days_off = stoi(argv[++i]);
+            else if (arg == "-max-consec-days-off") generator.max_consec_days_off = stoi(argv[++i]);
+            else if (arg == "-seed") generator.seed = stoi(argv[++i]);
+            else if (arg == "-threads") options.threads = stoi(argv[++i]);
+            else if (arg == "-timeout") timeout = stoi(argv[++i]);
+            else if (arg == "-backend") make_backend(backend = argv[++i]);
+            else throw invalid_argument("unknown option " + arg);
+        }
+    }
+    catch (const exception& e) {
+        cout << e.what() << endl;
+        cout << "Usage: " << endl
+             << "$ g++ bench.cpp generator.h generator.cpp scheduler.h scheduler.cpp parallel.h parallel.cpp lns.h lns.cpp" << endl
+             << "      sat.h sat.cpp backend.h backend.cpp -o bench -pthread" << endl
+             << "$ ./bench [-workers <n>,<n>,...] [-senior-ratio <value>] [-conflict-density <value>]" << endl
+             << "          [-conflict-size <value>] [-tightness <value>] [-weeks <value>]" << endl
+             << "          [-min-days-off <value>] [-max-consec-days-off <value>] [-seed <value>]" << endl
+             << "          [-threads <value>] [-timeout <seconds>] [-backend search|sat] [-gen <output_file>]" << endl
+             << endl;
+        return 1;
+    }
+
+    // only write the instance, for the first worker count
+    if (gen_file != "") {
+        generator.workers = sizes[0];
+        ofstream out(gen_file);
+        generate(out, generator);
+        return 0;
+    }
+
+    printf("%8s %8s %8s %9s %12s %12s %10s\n", "workers", "result", "load ms", "solve ms", "nodes", "backtracks", "peak KB");
+    for (int workers : sizes) {
+        generator.workers = workers;
+        char filename[] = "/tmp/bench_XXXXXX";
+        int fd = mkstemp(filename);
+        if (fd == -1) {
+            perror("mkstemp");
+            return 1;
+        }
+        close(fd);
+        {
+            ofstream out(filename);
+            generate(out, generator);
+        }
+
+        Measure m = run(filename, backend, options, timeout);
+        remove(filename);
+        printf("%8d %8s %8lld %9lld %12lld %12lld %10ld\n", workers, m.result.c_str(),
+               m.load_ms, m.solve_ms, m.nodes, m.backtracks, m.peak_kb);
+        fflush(stdout);
+    }
+    return 0;
+}
\ No newline at end of file
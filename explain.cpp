@@ -0,0 +1,163 @@
+#include "explain.h"
+#include "sat.h"
+
+#include <chrono>
+#include <memory>
+
+/// The schedule with only the constraints kept: kept[0..3] are the global ones, in the order of the selectors,
+/// then one per conflict group. A dropped global constraint gets the value that always holds.
+static Schedule relax(const Schedule& schedule, const std::vector<bool>& kept) {
+    Schedule relaxed = schedule;
+    if (!kept[0])
+        relaxed.min_days_off = 0;
+    if (!kept[1])
+        relaxed.max_consec_days_off = relaxed.days() + 1; // a run of that many days off can't happen
+    if (!kept[2])
+        relaxed.min_daily_staff = 0;
+    if (!kept[3])
+        relaxed.min_daily_seniors = 0;
+    std::vector<std::vector<int>> groups;
+    for (int c = 0; c < schedule.clique_count(); c++)
+        if (kept[4 + c])
+            groups.emplace_back(schedule.members(c).begin(), schedule.members(c).end());
+    relaxed.clique_members.clear();
+    relaxed.clique_start.assign(1, 0);
+    relaxed.add_conflicts(groups);
+    return relaxed;
+}
+
+int explain(const Schedule& schedule, Explanation& explanation, const SearchOptions& options) {
+    explanation = Explanation();
+    int count = 4 + schedule.clique_count();
+
+    // the name of each constraint
+    std::vector<std::string> names = {
+        "-min-days-off " + std::to_string(schedule.min_days_off),
+        "-max-consec-days-off " + std::to_string(schedule.max_consec_days_off),
+        "-min-daily-staff " + std::to_string(schedule.min_daily_staff),
+        "-min-daily-seniors " + std::to_string(schedule.min_daily_seniors),
+    };
+    for (int c = 0; c < schedule.clique_count(); c++) {
+        std::string name = "-conflict";
+        for (int w : schedule.members(c))
+            name += " " + schedule.workers[w].id;
+        names.push_back(name);
+    }
+
+    // the SAT encoding, made when the search can't settle a solve
+    Selectors selectors;
+    std::vector<int> selector; // constraint -> its selector
+    std::unordered_map<int, int> constraint_of;
+    std::unique_ptr<IncrementalSolver> solver;
+
+    // every solve shares the time limit, and gets at most EXPLAIN_SOLVE_LIMIT of it, half for each solver
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.time_limit);
+    SearchOptions local = options;
+    local.complete = nullptr;
+    local.partial = nullptr;
+    local.optimize = false;
+    local.lns = 0;
+    local.solutions = 0;
+    local.on_solution = nullptr;
+    local.warm_start = nullptr;
+    local.cost_limit = LLONG_MAX;
+
+    // whether the constraints kept have a solution, 1 or 0, or -1 when neither solver could tell within the limits.
+    // A SAT refutation sets core to the constraints it used
+    std::vector<int> core;
+    auto solve = [&](const std::vector<int>& constraints, bool& refuted_by_core) {
+        refuted_by_core = false;
+        local.time_limit = EXPLAIN_SOLVE_LIMIT;
+        if (options.time_limit > 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0)
+                return -1;
+            local.time_limit = std::min(local.time_limit, (long long)left.count());
+        }
+        explanation.solves++;
+
+        // the search settles most rosters at once, the counting of its constraints proving them infeasible
+        std::vector<bool> kept(count, false);
+        for (int k : constraints)
+            kept[k] = true;
+        Schedule relaxed = relax(schedule, kept);
+        bool complete = false;
+        SearchOptions search = local;
+        search.complete = &complete;
+        search.time_limit = std::max(1LL, local.time_limit / 2);
+        auto start = std::chrono::steady_clock::now();
+        if (scheduler(relaxed, search))
+            return 1;
+        if (complete)
+            return 0;
+
+        // the SAT backend with what it learned from the previous solves, narrowing by its cores
+        if (!solver) {
+            Cnf cnf = encode(schedule, &selectors);
+            selector = { selectors.min_days_off, selectors.max_consec_days_off,
+                         selectors.min_daily_staff, selectors.min_daily_seniors };
+            selector.insert(selector.end(), selectors.conflicts.begin(), selectors.conflicts.end());
+            for (int k = 0; k < count; k++)
+                constraint_of[selector[k]] = k;
+            solver = std::make_unique<IncrementalSolver>(cnf);
+        }
+        local.time_limit -= std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (local.time_limit <= 0)
+            return -1;
+        std::vector<int> assumptions, used;
+        for (int k : constraints)
+            assumptions.push_back(selector[k]);
+        int result = solver->solve(assumptions, used, local, options.stats);
+        if (result == 0) {
+            refuted_by_core = true;
+            core.clear();
+            for (int v : used)
+                core.push_back(constraint_of[v]);
+        }
+        return result;
+    };
+
+    // every constraint
+    std::vector<int> unknown(count), needed;
+    for (int k = 0; k < count; k++)
+        unknown[k] = k;
+    // keep the constraints left to check that the last refutation used
+    auto narrow = [&]() {
+        std::sort(core.begin(), core.end());
+        unknown.erase(std::remove_if(unknown.begin(), unknown.end(), [&](int k) {
+            return !std::binary_search(core.begin(), core.end(), k);
+        }), unknown.end());
+    };
+    bool refuted_by_core;
+    int result = solve(unknown, refuted_by_core);
+    if (result != 0)
+        return result;
+    if (refuted_by_core)
+        narrow();
+
+    // drop each of them in turn: they are needed when the others have a solution.
+    // One that no solver could settle is kept, the set is then not proven minimal
+    explanation.minimal = true;
+    while (!unknown.empty()) {
+        int candidate = unknown.back();
+        unknown.pop_back();
+        std::vector<int> constraints = needed;
+        constraints.insert(constraints.end(), unknown.begin(), unknown.end());
+        result = solve(constraints, refuted_by_core);
+        if (result == 0) {
+            if (refuted_by_core)
+                narrow();
+        }
+        else {
+            needed.push_back(candidate);
+            if (result == -1)
+                explanation.minimal = false;
+        }
+    }
+
+    std::sort(needed.begin(), needed.end());
+    for (int k : needed)
+        explanation.constraints.push_back(names[k]);
+    return 0;
+}
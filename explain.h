@@ -0,0 +1,29 @@
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+#include "scheduler.h"
+
+/// Why a schedule has no solution: constraints of the model that can't hold together
+struct Explanation {
+    std::vector<std::string> constraints; // as written in an input file, like "-min-daily-staff 4" or "-conflict a b"
+    bool minimal = false;                 // no constraint of them can be dropped, each one was checked
+    int solves = 0;                       // incremental solves it took
+};
+
+/// Milliseconds each solve of explain() gets at most, within options.time_limit when there is one
+const long long EXPLAIN_SOLVE_LIMIT = 1000;
+
+/// Find a minimal set of the constraints of the schedule that has no solution on its own: dropping any one
+/// of them leaves constraints that have one. The constraints are the four global ones and each conflict group,
+/// the options already removed from the domains (pinned days) always hold.
+/// The constraints are dropped one at a time: those without which there is a solution are kept.
+/// Each solve runs the search on the schedule with the constraints left, and when it can't tell within
+/// EXPLAIN_SOLVE_LIMIT, the SAT backend: the schedule is then encoded once with a selector per constraint
+/// (see encode()) and solved under assumptions, keeping the clauses learned from one solve to the next,
+/// each refutation narrowing the set to the constraints it used.
+/// Returns 1 when the schedule has a solution, 0 when it has none, with the explanation filled,
+/// and -1 when neither could tell for the first solve. A constraint neither could settle later is kept,
+/// the explanation then not being minimal.
+int explain(const Schedule& schedule, Explanation& explanation, const SearchOptions& options = {});
+
+#endif // EXPLAIN_H
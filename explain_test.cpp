@@ -0,0 +1,113 @@
+#include <iostream>
+
+#include "scheduler.h"
+#include "explain.h"
+
+using namespace std;
+
+/// A roster written out, so that it can be built again with only some of its constraints
+struct Roster {
+    string name;
+    vector<pair<string, string>> workers; // id, level
+    int values[4];                         // min days off, max consec days off, min daily staff, min daily seniors
+    vector<vector<string>> conflicts;
+};
+
+/// the names explain() gives the constraints, in its order: the four global ones, then each conflict group
+static vector<string> names(const Roster& roster) {
+    vector<string> out = { "-min-days-off " + to_string(roster.values[0]),
+                           "-max-consec-days-off " + to_string(roster.values[1]),
+                           "-min-daily-staff " + to_string(roster.values[2]),
+                           "-min-daily-seniors " + to_string(roster.values[3]) };
+    for (auto& group : roster.conflicts) {
+        string name = "-conflict";
+        for (auto& id : group)
+            name += " " + id;
+        out.push_back(name);
+    }
+    return out;
+}
+
+/// the roster with only the kept constraints, the others set to values that always hold
+static Schedule build(const Roster& roster, const vector<bool>& kept) {
+    Schedule schedule;
+    for (auto& worker : roster.workers)
+        schedule.add_worker(worker.first, worker.second);
+    schedule.min_days_off = kept[0] ? roster.values[0] : 0;
+    schedule.max_consec_days_off = kept[1] ? roster.values[1] : schedule.days() + 1;
+    schedule.min_daily_staff = kept[2] ? roster.values[2] : 0;
+    schedule.min_daily_seniors = kept[3] ? roster.values[3] : 0;
+    for (size_t c = 0; c < roster.conflicts.size(); c++)
+        if (kept[4 + c])
+            schedule.add_conflict(roster.conflicts[c]);
+    return schedule;
+}
+
+static bool solvable(const Roster& roster, const vector<bool>& kept) {
+    Schedule schedule = build(roster, kept);
+    return scheduler(schedule);
+}
+
+/// The explanation of an infeasible roster must have no solution on its own,
+/// and one as soon as any of its constraints is dropped
+static bool check(const Roster& roster) {
+    vector<string> all = names(roster);
+    Schedule schedule = build(roster, vector<bool>(all.size(), true));
+    Explanation explanation;
+    if (explain(schedule, explanation) != 0 || !explanation.minimal) {
+        cout << roster.name << ": no minimal explanation" << endl;
+        return false;
+    }
+    vector<bool> kept(all.size(), false);
+    for (auto& constraint : explanation.constraints) {
+        auto it = find(all.begin(), all.end(), constraint);
+        if (it == all.end()) {
+            cout << roster.name << ": unknown constraint " << constraint << endl;
+            return false;
+        }
+        kept[it - all.begin()] = true;
+    }
+    if (solvable(roster, kept)) {
+        cout << roster.name << ": the explanation has a solution" << endl;
+        return false;
+    }
+    for (size_t k = 0; k < all.size(); k++) {
+        if (!kept[k])
+            continue;
+        kept[k] = false;
+        bool ok = solvable(roster, kept);
+        kept[k] = true;
+        if (!ok) {
+            cout << roster.name << ": the explanation still has no solution without " << all[k] << endl;
+            return false;
+        }
+    }
+    cout << roster.name << ": ok" << endl;
+    return true;
+}
+
+int main() {
+    vector<pair<string, string>> sample = { { "1", "senior" }, { "2", "junior" }, { "3", "junior" },
+                                            { "4", "senior" }, { "5", "junior" } };
+    vector<Roster> rosters = {
+        { "off the whole week", { { "a", "junior" }, { "b", "senior" } }, { 7, 3, 0, 0 }, {} },
+        { "too many days off", sample, { 5, 3, 3, 1 }, { { "2", "4" } } },
+        { "too much staff", sample, { 2, 3, 5, 1 }, { { "2", "4" } } },
+        { "conflicting seniors", { { "a", "senior" }, { "b", "senior" }, { "c", "junior" } }, { 0, 3, 1, 2 },
+          { { "a", "b" } } },
+        { "conflicting staff", sample, { 2, 7, 4, 0 }, { { "1", "2" }, { "3", "4" } } },
+    };
+    bool ok = true;
+    for (auto& roster : rosters)
+        ok = check(roster) && ok;
+
+    // a roster with a solution has nothing to explain
+    Roster solvable_roster = { "input.txt", sample, { 2, 3, 3, 1 }, { { "2", "4" } } };
+    Schedule feasible = build(solvable_roster, vector<bool>(5, true));
+    Explanation explanation;
+    if (explain(feasible, explanation) != 1) {
+        cout << "feasible roster: explained" << endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
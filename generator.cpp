@@ -0,0 +1,42 @@
+#include "generator.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+void generate(std::ostream& out, const GeneratorOptions& options) {
+    std::mt19937 random(options.seed);
+    int n = options.workers;
+
+    // pick the seniors at random
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+    int seniors = (int)(options.senior_ratio * n + 0.5);
+    std::vector<bool> senior(n, false);
+    for (int i = 0; i < seniors; i++)
+        senior[order[i]] = true;
+
+    for (int i = 0; i < n; i++)
+        out << "w" << i << (senior[i] ? " senior" : " junior") << "\n";
+
+    // the workers in conflict are split into groups, taken in a new random order
+    std::shuffle(order.begin(), order.end(), random);
+    int in_conflict = (int)(options.conflict_density * n + 0.5);
+    int size = std::max(2, options.conflict_size);
+    for (int i = 0; i + size <= in_conflict; i += size) {
+        out << "-conflict";
+        for (int j = i; j < i + size; j++)
+            out << " w" << order[j];
+        out << "\n";
+    }
+
+    // on average a worker can work (7 - min days off) days a week
+    double available = (7.0 - options.min_days_off) / 7.0;
+    out << "-weeks " << options.weeks << "\n";
+    out << "-min-days-off " << options.min_days_off << "\n";
+    out << "-max-consec-days-off " << options.max_consec_days_off << "\n";
+    out << "-min-daily-staff " << std::max(1, (int)(options.tightness * n * available)) << "\n";
+    out << "-min-daily-seniors " << (int)(options.tightness * seniors * available) << "\n";
+}
@@ -0,0 +1,23 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <ostream>
+
+/// Parameters of a synthetic instance
+struct GeneratorOptions {
+    int workers             = 100;
+    double senior_ratio     = 0.3; // fraction of the workers that are seniors
+    double conflict_density = 0.1; // fraction of the workers that belong to a conflict group
+    int conflict_size       = 2;   // number of workers per conflict group
+    double tightness        = 0.5; // daily staff and seniors required, as a fraction of what the workers can provide
+    int weeks               = 1;
+    int min_days_off        = 2;
+    int max_consec_days_off = 3;
+    unsigned seed           = 1;
+};
+
+/// Write a random instance in the format read by load_file.
+/// The workers are named w0, w1, ...
+void generate(std::ostream& out, const GeneratorOptions& options);
+
+#endif // GENERATOR_H
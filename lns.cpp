@@ -0,0 +1,135 @@
+#include "lns.h"
+
+#include <chrono>
+#include <random>
+
+const int TEAM_SIZE = 8; // workers freed together by the team neighborhood
+
+/// Assignment of a complete schedule: worker -> days on duty.
+typedef std::vector<Days> Assignment;
+
+static Assignment read(Schedule& schedule) {
+    Assignment assignment(schedule.workers.size());
+    for (int w = 0; w < (int)schedule.workers.size(); w++) {
+        Domain& domain = schedule.workers[w].domain;
+        assignment[w] = domain.on & ~domain.off;
+    }
+    return assignment;
+}
+
+/// Feasibility oracle: every day of every worker is decided and satisfies the constraints.
+static bool feasible(Schedule& schedule) {
+    for (int w = 0; w < (int)schedule.workers.size(); w++) {
+        Domain& domain = schedule.workers[w].domain;
+        if ((domain.on ^ domain.off) != schedule.all_days())
+            return false;
+        if (!Constraint::check_min_days_off(schedule, w) || !Constraint::check_max_consec_days_off(schedule, w))
+            return false;
+        for (int i = 0; i < schedule.days(); i++)
+            if (!Constraint::check_min_daily_staff(schedule, w, i) || !Constraint::check_conflicts(schedule, w, i))
+                return false;
+    }
+    return true;
+}
+
+/// Pick the next neighborhood to free, in turn one day, a worker with his conflicts, and a team.
+static void neighborhood(Schedule& schedule, int iteration, std::mt19937& random, std::vector<Days>& freed) {
+    int n = schedule.workers.size();
+    freed.assign(n, 0);
+    switch (iteration % 3) {
+        case 0: { // one day, for every worker
+            int day = random() % schedule.days();
+            for (int w = 0; w < n; w++)
+                freed[w] = day_bit(day);
+            break;
+        }
+        case 1: { // a worker and the workers he conflicts with, every day
+            int worker = random() % n;
+            freed[worker] = schedule.all_days();
+            for (int other : schedule.conflicting(worker))
+                freed[other] = schedule.all_days();
+            break;
+        }
+        default: { // the workers listed next to each other in the input, every day
+            int start = random() % n;
+            for (int w = start; w < std::min(n, start + TEAM_SIZE); w++)
+                freed[w] = schedule.all_days();
+            break;
+        }
+    }
+}
+
+bool lns_scheduler(Schedule& schedule, const SearchOptions& options) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto deadline = start_time + std::chrono::milliseconds(options.lns);
+    auto remaining = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    };
+
+    // the neighborhoods are re-solved by the exact optimizing search, single threaded
+    SearchOptions local = options;
+    local.lns = 0;
+    local.threads = 1;
+    local.optimize = true;
+    local.complete = nullptr;
+    local.partial = nullptr;
+    local.node_limit = 0; // the neighborhoods are bounded by time
+    local.on_solution = nullptr;
+    if (options.complete)
+        *options.complete = false;
+
+    // start from the first schedule found, unless the caller stops it first
+    Schedule work = schedule;
+    size_t root = work.trail.size();
+    std::atomic<bool> first { false };
+    SearchOptions initial = local;
+    initial.time_limit = std::max<long long>(1, remaining());
+    initial.stop = &first;
+    initial.outer_stop = options.stop;
+    initial.on_solution = [&](Schedule&, long long) { first = true; };
+    // without a schedule, the first search may have proved there is none
+    bool proved = false;
+    initial.complete = &proved;
+    if (!scheduler(work, initial)) {
+        if (options.complete)
+            *options.complete = proved;
+        return false;
+    }
+    if (!feasible(work))
+        return false;
+    Assignment best = read(work);
+    long long best_cost = work.cost;
+    if (options.on_solution)
+        options.on_solution(work, best_cost);
+    work.undo(root);
+
+    // then move to the best schedule of a neighborhood, as long as it is not worse
+    std::mt19937 random(options.seed);
+    std::vector<Days> freed;
+    long long step = std::max<long long>(20, options.lns / 50); // milliseconds per neighborhood
+    for (int iteration = 0; remaining() > 0; iteration++) {
+        if (options.stop && options.stop->load())
+            break;
+        neighborhood(work, iteration, random, freed);
+        if (work.fix_assignment(best, freed)) {
+            local.time_limit = std::max<long long>(1, std::min<long long>(step, remaining()));
+            local.cost_limit = best_cost + 1;
+            if (scheduler(work, local) && feasible(work)) {
+                bool improved = work.cost < best_cost;
+                best = read(work);
+                best_cost = work.cost;
+                if (improved && options.on_solution)
+                    options.on_solution(work, best_cost);
+            }
+        }
+        else
+            work.clear_queue();
+        work.undo(root);
+    }
+
+    // decide every day of the schedule as in the best one
+    freed.assign(work.workers.size(), 0);
+    work.fix_assignment(best, freed);
+    schedule = work;
+    return true;
+}
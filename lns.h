@@ -0,0 +1,13 @@
+#ifndef LNS_H
+#define LNS_H
+
+#include "scheduler.h"
+
+/// Improve the schedule by large neighborhood search for options.lns milliseconds.
+/// Starting from the first schedule the exact search finds, repeatedly free a neighborhood
+/// (one day, a worker and those he conflicts with, or a team of workers listed together),
+/// keep every other day as it is and re-solve the neighborhood with the optimizing search,
+/// keeping the result when it is no worse. Each improving schedule is reported to options.on_solution.
+bool lns_scheduler(Schedule& schedule, const SearchOptions& options);
+
+#endif // LNS_H
@@ -1,20 +1,164 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <new>
 
 #include "scheduler.h"
+#include "repair.h"
+#include "batch.h"
+#include "backend.h"
+#include "sat.h"
+#include "explain.h"
+#include "server.h"
 
 using namespace std;
 
+#ifdef COUNT_ALLOCATIONS
+// count the heap allocations of each thread for -stats, see heap_allocations.
+// GCC takes the free() of what this operator new returns for a mismatch once they are inlined together
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void* operator new(size_t size) {
+    heap_allocations++;
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+static const bool counting = allocations_counted = true;
+#endif
+
+/// Parse the search option at argv[i], shared by a single roster, the batch and the server, moving i past its value.
+/// Returns false when it is not one of them
+static bool search_option(char* argv[], int& i, string& backend, SearchOptions& options) {
+    string arg = argv[i];
+    if (arg == "-backend") {
+        backend = argv[++i];
+        make_backend(backend);
+    }
+    else if (arg == "-no-backjump") {
+        options.backjump = false;
+    }
+    else if (arg == "-nogoods") {
+        options.nogoods = stoi(argv[++i]);
+    }
+    else if (arg == "-optimize") {
+        options.optimize = true;
+    }
+    else if (arg == "-symmetry") {
+        options.symmetry = true;
+    }
+    else if (arg == "-patterns") {
+        options.patterns = true;
+    }
+    else if (arg == "-lns") {
+        options.lns = stoll(argv[++i]);
+    }
+    else if (arg == "-time-limit") {
+        options.time_limit = stoll(argv[++i]);
+    }
+    else if (arg == "-node-limit") {
+        options.node_limit = stoll(argv[++i]);
+    }
+    else
+        return false;
+    return true;
+}
+
+/// Solve the instances listed by a manifest or a directory, see solve_batch()
+static int run_batch(int argc, char* argv[]) {
+    string output_dir = "";
+    int jobs = thread::hardware_concurrency();
+    string backend = "search";
+    SearchOptions options;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-out-dir") {
+            output_dir = argv[++i];
+        }
+        else if (arg == "-jobs") {
+            jobs = stoi(argv[++i]);
+        }
+        else if (!search_option(argv, i, backend, options))
+            throw invalid_argument("unknown batch option " + arg);
+    }
+
+    vector<string> inputs = batch_inputs(argv[2]);
+    auto start_time = chrono::high_resolution_clock::now();
+    vector<BatchResult> results = solve_batch(inputs, output_dir, jobs, backend, options);
+    auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - start_time).count();
+
+    int solved = 0, failed = 0;
+    long long total = 0;
+    for (auto& result : results) {
+        cout << result.input << ": ";
+        if (!result.error.empty())
+            cout << "error: " << result.error;
+        else
+            cout << (result.solved ? "solved" : "no solution") << ", " << result.milliseconds << " ms -> " << result.output;
+        cout << endl;
+        solved += result.solved;
+        failed += !result.error.empty();
+        total += result.milliseconds;
+    }
+    cout << endl << "Instances: " << results.size() << " (" << solved << " solved, " << failed << " errors)" << endl;
+    cout << "Jobs: " << max(1, jobs) << endl;
+    cout << "Duration: " << duration << " ms, " << total << " ms of instances" << endl;
+    if (duration > 0)
+        cout << "Throughput: " << results.size() * 1000.0 / duration << " instances/s" << endl;
+    return failed ? 1 : 0;
+}
+
+/// Answer the requests of the standard input on the standard output, see serve()
+static int run_server(int argc, char* argv[]) {
+    int jobs = thread::hardware_concurrency();
+    size_t cache = 256;
+    string backend = "search";
+    SearchOptions options;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-jobs") {
+            jobs = stoi(argv[++i]);
+        }
+        else if (arg == "-cache") {
+            cache = max(stoll(argv[++i]), 0LL);
+        }
+        else if (!search_option(argv, i, backend, options))
+            throw invalid_argument("unknown server option " + arg);
+    }
+    serve(cin, cout, jobs, cache, backend, options);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     string output_file = "";
+    string stats_file = "";
+    string changes_file = "";
+    vector<Change> changes;
+    string dimacs_file = "";
+    unique_ptr<Backend> backend = make_backend("search");
+    bool print_stats = false;
+    bool explain_failure = false;
+    bool count_only = false;
+    Stats stats;
     Schedule schedule;
+    SearchOptions options;
 
     try {
+        if (argc > 2 && string(argv[1]) == "-batch")
+            return run_batch(argc, argv);
+        if (argc > 1 && string(argv[1]) == "-serve")
+            return run_server(argc, argv);
+
         string filename = argv[1];
         schedule = load_file(filename);
 
+        string backend_name = "search";
         for (int i = 2; i < argc; i++) {
+            if (search_option(argv, i, backend_name, options))
+                continue;
             string arg = argv[i];
             if (arg == "-o") {
                 output_file = argv[++i];
@@ -31,58 +175,269 @@ int main(int argc, char* argv[]) {
             else if (arg == "-min-daily-seniors") {
                 schedule.min_daily_seniors = stoi(argv[++i]);
             }
+            else if (arg == "-weeks") {
+                schedule.set_weeks(stoi(argv[++i]));
+            }
+            else if (arg == "-threads") {
+                options.threads = stoi(argv[++i]);
+            }
+            else if (arg == "-portfolio") {
+                options.portfolio = true;
+            }
+            else if (arg == "-dimacs") {
+                dimacs_file = argv[++i];
+            }
+            else if (arg == "-solutions") {
+                options.solutions = max(stoll(argv[++i]), 0LL);
+            }
+            else if (arg == "-count") {
+                options.solutions = LLONG_MAX;
+                count_only = true;
+            }
+            else if (arg == "-request-off") {
+                string id = argv[++i];
+                while (++i < argc && argv[i][0] != '-') {
+                    schedule.add_request_off(id, stoi(argv[i]));
+                }
+                --i;
+            }
+            else if (arg == "-weight-requests") {
+                schedule.request_weight = stoi(argv[++i]);
+            }
+            else if (arg == "-weight-weekends") {
+                schedule.weekend_weight = stoi(argv[++i]);
+            }
+            else if (arg == "-weight-excess") {
+                schedule.excess_weight = stoi(argv[++i]);
+            }
+            else if (arg == "-changes") {
+                changes_file = argv[++i];
+                changes = load_changes(changes_file); // read before solving, to report a bad file at once
+            }
+            else if (arg == "-explain") {
+                explain_failure = true;
+            }
+            else if (arg == "-stats") {
+                print_stats = true;
+            }
+            else if (arg == "-stats-json") {
+                stats_file = argv[++i];
+            }
             else if (arg == "-conflict") {
                 vector<string> ids;
                 while (++i < argc && argv[i][0] != '-') {
                     ids.push_back(argv[i]);
                 }
                 --i;
-                for (auto& id : ids) {
-                    schedule.conflicts[id].insert(ids.begin(), ids.end());
-                    schedule.conflicts[id].erase(id);
-                }
+                schedule.add_conflict(ids);
             }
         }
+        backend = make_backend(backend_name);
+        if (options.solutions > 0 && (options.optimize || options.lns > 0))
+            throw invalid_argument("-solutions and -count do not optimize");
     }
     catch (const exception& e) {
         cout << e.what() << endl;
         cout << "Usage: " << endl
-             << "$ g++ main.cpp scheduler.h  scheduler.cpp -o main" << endl
+             << "$ g++ main.cpp scheduler.h scheduler.cpp parallel.h parallel.cpp lns.h lns.cpp repair.h repair.cpp batch.h batch.cpp" << endl
+             << "      sat.h sat.cpp backend.h backend.cpp explain.h explain.cpp server.h server.cpp -o main -pthread" << endl
              << "$ ./main <input_file> [-o <output_file>] [-min-days-off <value>]" << endl
              << "                   [-max-consec-days-off <value>] [-min-daily-staff <value>]" << endl
              << "                   [-min-daily-seniors <value>] [-conflict <worker_id> <worker_id> ...]" << endl
+             << "                   [-weeks <value>] [-threads <value>] [-portfolio]" << endl
+             << "                   [-backend search|sat] [-dimacs <output_file>]" << endl
+             << "                   [-no-backjump] [-nogoods <value>] [-symmetry] [-patterns]" << endl
+             << "                   [-optimize] [-time-limit <ms>] [-node-limit <value>] [-lns <ms>]" << endl
+             << "                   [-solutions <value>] [-count]" << endl
+             << "                   [-request-off <worker_id> <day> ...]" << endl
+             << "                   [-weight-requests <value>] [-weight-weekends <value>] [-weight-excess <value>]" << endl
+             << "                   [-changes <changes_file>] [-explain] [-stats] [-stats-json <output_file>]" << endl
+             << "$ ./main -batch <manifest_file|directory> [-out-dir <directory>] [-jobs <value>] [-backend search|sat]" << endl
+             << "                   [-no-backjump] [-nogoods <value>] [-symmetry] [-patterns] [-optimize]" << endl
+             << "                   [-time-limit <ms>] [-node-limit <value>] [-lns <ms>]" << endl
+             << "$ ./main -serve [-jobs <value>] [-cache <value>] [-backend search|sat]" << endl
+             << "                   [-no-backjump] [-nogoods <value>] [-symmetry] [-patterns] [-optimize]" << endl
+             << "                   [-time-limit <ms>] [-node-limit <value>] [-lns <ms>]" << endl
              << endl;
         return 1;
     }
 
     // print constraints
+    cout << "Weeks: " << schedule.weeks << endl;
     cout << "Min days off: " << schedule.min_days_off << endl;
     cout << "Max consec days off: " << schedule.max_consec_days_off << endl;
     cout << "Min daily staff: " << schedule.min_daily_staff << endl;
     cout << "Min daily seniors: " << schedule.min_daily_seniors << endl;
     cout << "Conflicts: " << endl;
-    for (auto& pair : schedule.conflicts) {
-        cout << pair.first << ": ";
-        for (auto& id : pair.second) {
-            cout << id << " ";
+    for (int w = 0; w < (int)schedule.workers.size(); w++) {
+        if (schedule.degree[w] == 0) continue;
+        cout << schedule.workers[w].id << ": ";
+        for (int other : schedule.conflicting(w)) {
+            cout << schedule.workers[other].id << " ";
         }
         cout << endl;
     }
+    if (options.optimize || options.lns > 0) {
+        cout << "Day-off requests: " << endl;
+        for (auto& worker : schedule.workers) {
+            if (!worker.requested_off) continue;
+            cout << worker.id << ": ";
+            for (int i = 0; i < schedule.days(); i++)
+                if (worker.requested_off >> i & 1)
+                    cout << i + 1 << " ";
+            cout << endl;
+        }
+        cout << "Weights: requests " << schedule.request_weight << ", weekends " << schedule.weekend_weight
+             << ", excess staff " << schedule.excess_weight << endl;
+    }
     cout << endl;
 
     ofstream fout = ofstream(output_file);
     ostream& out = output_file == "" ? cout : fout;
 
+    if (print_stats || stats_file != "")
+        options.stats = &stats;
+
+    // export the model before solving it
+    if (dimacs_file != "") {
+        ofstream dimacs(dimacs_file);
+        write_dimacs(encode(schedule), dimacs);
+    }
+
+    // the model as loaded, the search leaving what it propagated in the schedule
+    Schedule model;
+    if (explain_failure)
+        model = schedule;
+
     auto start_time = chrono::high_resolution_clock::now();
-    bool success = scheduler(schedule);
+    bool complete = false;
+    options.complete = &complete;
+    Partial partial;
+    options.partial = &partial;
+    // enumerated schedules, and those they stand for with the interchangeable workers in any order
+    long long found = 0, orders = 0;
+    options.on_solution = [&](Schedule& solved, long long cost) {
+        if (options.solutions > 0) {
+            found++;
+            orders += min(solved.symmetric_count(), LLONG_MAX - orders);
+            if (!count_only) {
+                out << "Schedule " << found << ":" << endl;
+                solved.write(out);
+                out << endl;
+            }
+            return;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - start_time);
+        cout << "Found cost " << cost << " after " << elapsed.count() << " ms" << endl;
+    };
+    bool success = false;
+    try {
+        success = backend->solve(schedule, options);
+    }
+    catch (const exception& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
     auto end_time = chrono::high_resolution_clock::now();
     auto duration = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
 
-    if (success)
-        out << schedule.to_string() << endl;
+    if (success) {
+        if (options.solutions == 0) { // the enumerated ones are written as they are found
+            schedule.write(out);
+            out << endl;
+        }
+    }
+    else if (!complete && (partial.decided > 0 || partial.worker != -1)) {
+        // out of budget: the deepest node reached, its undecided days as -
+        out << "No solution found within the limits. Partial schedule:" << endl;
+        schedule.write(out);
+        out << endl;
+    }
     else
-        out << "No solution found." << endl;
+        out << (complete ? "No solution found." : "No solution found within the limits.") << endl;
 
+    if (success && (options.optimize || options.lns > 0))
+        cout << "Cost: " << schedule.cost << (complete ? " (optimal)" : "") << endl;
+    if (success && options.solutions > 0) {
+        cout << "Schedules: " << found << (complete ? " (all of them)" : "") << endl;
+        if (options.symmetry)
+            cout << "With interchangeable workers in any order: " << orders << endl;
+    }
+    if (!success && !complete && (partial.decided > 0 || partial.worker != -1)) {
+        long long total = (long long)schedule.workers.size() * schedule.days();
+        cout << "Decided days: " << partial.decided << " of " << total << endl;
+        if (partial.worker != -1) {
+            auto name = [](int type) { return type == -1 ? "nothing" : CONSTRAINT_NAMES[type]; };
+            cout << "Blocking: worker " << schedule.workers[partial.worker].id << " on day " << partial.day + 1
+                 << ": on duty breaks " << name(partial.blocking_on)
+                 << ", off duty breaks " << name(partial.blocking_off) << endl;
+        }
+    }
     cout << "Duration: " << duration << " ms" << endl;
+
+    // find the constraints that can't hold together
+    if (!success && explain_failure) {
+        Explanation explanation;
+        start_time = chrono::high_resolution_clock::now();
+        int result = explain(model, explanation, options);
+        duration = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - start_time).count();
+        if (result == 1)
+            cout << "The constraints have a solution, the search ran out of budget first." << endl;
+        else if (result == -1)
+            cout << "No explanation found within the limits." << endl;
+        else if (explanation.constraints.empty())
+            cout << "The days already decided have no solution, whatever the constraints." << endl;
+        else {
+            cout << "Conflicting constraints" << (explanation.minimal ? "" : " (not minimal, out of budget)") << ":" << endl;
+            for (auto& constraint : explanation.constraints)
+                cout << constraint << endl;
+        }
+        cout << "Explanation duration: " << duration << " ms, " << explanation.solves << " solves" << endl;
+    }
+
+    // apply the changes and repair the schedule
+    if (success && changes_file != "" && options.solutions == 0) {
+        std::unordered_map<string, Days> previous;
+        for (auto& worker : schedule.workers)
+            previous[worker.id] = worker.domain.on & ~worker.domain.off;
+
+        start_time = chrono::high_resolution_clock::now();
+        try {
+            success = repair(schedule, changes, options);
+        }
+        catch (const exception& e) {
+            cout << e.what() << endl;
+            return 1;
+        }
+        end_time = chrono::high_resolution_clock::now();
+        duration = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
+
+        out << "Repaired:" << endl;
+        if (success) {
+            schedule.write(out);
+            out << endl;
+        }
+        else
+            out << "No solution found." << endl;
+
+        // count the days that changed for the workers that were already there
+        int changed = 0;
+        for (auto& worker : schedule.workers) {
+            auto it = previous.find(worker.id);
+            if (it != previous.end())
+                changed += Domain::count((worker.domain.on & ~worker.domain.off) ^ it->second);
+        }
+        if (success)
+            cout << "Changed days: " << changed << endl;
+        cout << "Repair duration: " << duration << " ms" << endl;
+    }
+
+    if (print_stats)
+        stats.write(cout);
+    if (stats_file != "") {
+        ofstream json(stats_file);
+        stats.write_json(json);
+        json << endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "parallel.h"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+
+/// Subproblem: the decisions leading from the root of the search tree to a node.
+/// Each decision is stored as the domain value it removes.
+typedef std::vector<Removal> Path;
+
+/// Apply the decisions of the path, propagating each one as the search would.
+static bool replay(Schedule& schedule, const Path& path) {
+    for (auto& r : path)
+        if (!Constraint::prune(schedule, r.worker, r.day, r.on_duty) ||
+                !Constraint::propagate(schedule))
+            return false;
+    return true;
+}
+
+/// Collect the nodes of the search tree at the given depth,
+/// branching exactly like scheduler() and skipping the assignments that fail propagation.
+/// A warm started split tries the value of the previous schedule first, so the first path follows it.
+static void split(Schedule& schedule, Path& path, int depth, std::vector<Path>& paths,
+                  const std::vector<Days>* warm_start) {
+    int worker = mrv(schedule);
+    if (depth == 0 || worker == -1) {
+        paths.push_back(path);
+        return;
+    }
+
+    Domain& domain = schedule.workers[worker].domain;
+    int day = first_day(domain.on & domain.off);
+    bool on_first = !warm_start || ((*warm_start)[worker] >> day & 1);
+    for (bool on_duty : { on_first, !on_first }) {
+        size_t mark = schedule.trail.size();
+        if (Constraint::prune(schedule, worker, day, !on_duty) &&
+                Constraint::propagate(schedule)) {
+            path.push_back({ worker, day, !on_duty });
+            split(schedule, path, depth - 1, paths, warm_start);
+            path.pop_back();
+        }
+        schedule.undo(mark);
+    }
+}
+
+/// Tasks owned by one thread. The owner takes from the back, the other threads steal from the front.
+struct TaskQueue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+};
+
+/// The first thread to finish stores its schedule and stops the others.
+/// When enumerating, the threads pass on their schedules one at a time, until there are enough of them.
+struct Result {
+    std::mutex mutex;
+    std::atomic<bool> stop { false };
+    std::atomic<bool> exhausted { false }; // a thread ran out of time or nodes, or enough schedules were enumerated
+    bool found = false;
+    long long solutions = 0;               // schedules enumerated
+    Stats stats;
+
+    /// add the statistics of a thread that is done
+    void add(const Stats& local) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.add(local);
+    }
+
+    void finish(Schedule& schedule, Schedule& local, bool success) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (success && !found) {
+            found = true;
+            schedule = local;
+        }
+        stop = true;
+    }
+
+    void enumerate(Schedule& local, long long cost, const SearchOptions& limits) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (solutions >= limits.solutions) // another thread got the last one
+            return;
+        found = true;
+        solutions++;
+        if (limits.on_solution)
+            limits.on_solution(local, cost);
+        if (solutions == limits.solutions) {
+            exhausted = true;
+            stop = true;
+        }
+    }
+};
+
+/// The caller's settings for a search thread: single threaded, with its own statistics and outcome,
+/// and stopped by the first thread to finish as well as by the caller
+static SearchOptions thread_options(const SearchOptions& limits, Result& result, Stats& stats, bool& complete) {
+    SearchOptions options = limits;
+    options.threads = 1;
+    options.stop = &result.stop;
+    if (limits.stop) // the caller's own outer_stop is only set on single threaded searches, see lns_scheduler()
+        options.outer_stop = limits.stop;
+    options.stats = &stats;
+    options.complete = &complete;
+    options.partial = nullptr;
+    options.on_solution = nullptr;
+    return options;
+}
+
+/// Every thread solves the whole problem, thread 0 with the default heuristics.
+/// The search is complete whatever the seed, so the first one to finish gives the answer.
+static void portfolio(Schedule& schedule, const SearchOptions& limits, Result& result) {
+    int threads = limits.threads;
+    // every thread searches one order of the same interchangeable workers
+    Schedule root = schedule;
+    if (limits.symmetry)
+        root.chain_symmetries();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&, t]() {
+            Schedule local = root;
+            Stats stats;
+            bool complete = true;
+            SearchOptions options = thread_options(limits, result, stats, complete);
+            options.seed = t;
+            bool success = scheduler(local, options);
+            if (!success && !complete && !result.stop)
+                result.exhausted = true;
+            // out of budget, an other thread may still finish
+            else if (!result.stop)
+                result.finish(schedule, local, success);
+            result.add(stats);
+        });
+    }
+    for (auto& thread : pool)
+        thread.join();
+}
+
+/// The threads share the subproblems at the top of the search tree.
+static void work_stealing(Schedule& schedule, const SearchOptions& limits, Result& result) {
+    int threads = limits.threads;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.time_limit);
+    // split the top of the tree into about 8 subproblems per thread
+    int depth = 0;
+    while ((1 << depth) < threads * 8 && depth < 20)
+        depth++;
+    std::vector<Path> paths;
+    Path path;
+    Schedule root = schedule;
+    // ordering the interchangeable workers before splitting, every subproblem orders the same ones
+    if (limits.symmetry)
+        root.chain_symmetries();
+    // the split and the replays propagate like the searches will
+    root.patterns = limits.patterns;
+    root.build_heap();
+    if (!Constraint::propagate_all(root))
+        return;
+    split(root, path, depth, paths, limits.warm_start);
+
+    // deal the subproblems to the threads' queues, each owner taking its own in the order of the search tree
+    std::vector<TaskQueue> queues(threads);
+    for (int i = 0; i < (int)paths.size(); i++)
+        queues[i % threads].tasks.push_front(i);
+
+    // take a task from the own queue, or steal one from the others
+    auto next_task = [&](int t) {
+        for (int k = 0; k < threads; k++) {
+            TaskQueue& queue = queues[(t + k) % threads];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                int task;
+                if (k == 0) {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                } else {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+                return task;
+            }
+        }
+        return -1;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&, t]() {
+            Schedule local = root;
+            Stats stats;
+            bool complete = true;
+            SearchOptions options = thread_options(limits, result, stats, complete);
+            if (limits.solutions > 0) {
+                options.solutions = LLONG_MAX; // until the others have enough
+                options.on_solution = [&](Schedule& found, long long cost) { result.enumerate(found, cost, limits); };
+            }
+            for (int task = next_task(t); task != -1 && !result.stop; task = next_task(t)) {
+                // the budget is shared by the tasks of the thread
+                if (limits.time_limit > 0) {
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+                    options.time_limit = std::max<long long>(1, remaining);
+                }
+                if (limits.node_limit > 0)
+                    options.node_limit = std::max<long long>(1, limits.node_limit - stats.nodes);
+                size_t mark = local.trail.size();
+                if (replay(local, paths[task]) && scheduler(local, options) && limits.solutions == 0) {
+                    result.finish(schedule, local, true);
+                    break;
+                }
+                local.undo(mark);
+                if (!complete && !result.stop) {
+                    result.exhausted = true;
+                    break;
+                }
+            }
+            result.add(stats);
+        });
+    }
+    for (auto& thread : pool)
+        thread.join();
+}
+
+bool parallel_scheduler(Schedule& schedule, const SearchOptions& options) {
+    Result result;
+    // racing searches would enumerate the same schedules
+    if (options.portfolio && options.solutions == 0)
+        portfolio(schedule, options, result);
+    else
+        work_stealing(schedule, options, result);
+    schedule.symmetric_prev.clear(); // the chains of the thread that found it
+    schedule.symmetric_next.clear();
+    if (options.stats)
+        options.stats->add(result.stats);
+    if (options.complete)
+        *options.complete = (result.found && options.solutions == 0) || !result.exhausted;
+    return result.found;
+}
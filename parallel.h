@@ -0,0 +1,15 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "scheduler.h"
+
+/// Solve the scheduling problem with options.threads threads.
+/// By default the top of the search tree is split into subproblems, which the threads share
+/// through work-stealing queues. With options.portfolio, every thread instead searches the whole
+/// problem with differently seeded heuristics. All threads stop as soon as one of them finishes.
+/// When enumerating (options.solutions), the threads enumerate the subproblems instead, even with
+/// options.portfolio, and stop once they have passed enough schedules to options.on_solution, one at a time.
+/// The time and node limits of the options apply to each thread, and no partial schedule is reported.
+bool parallel_scheduler(Schedule& schedule, const SearchOptions& options);
+
+#endif // PARALLEL_H
@@ -0,0 +1,218 @@
+#include "repair.h"
+
+Schedule apply_changes(const Schedule& old, const std::vector<Change>& changes) {
+    std::vector<Worker> workers = old.workers;
+    std::vector<std::vector<std::string>> conflicts(old.clique_count());
+    for (int c = 0; c < old.clique_count(); c++)
+        for (int w : old.members(c))
+            conflicts[c].push_back(old.workers[w].id);
+    int min_daily_staff = old.min_daily_staff;
+
+    auto find = [&](const std::string& id) {
+        return std::find_if(workers.begin(), workers.end(), [&](const Worker& w) { return w.id == id; });
+    };
+    for (auto& change : changes) {
+        auto it = change.ids.empty() ? workers.end() : find(change.ids[0]);
+        switch (change.type) {
+            case Change::ADD_WORKER:
+                if (it == workers.end()) {
+                    workers.push_back(Worker());
+                    it = workers.end() - 1;
+                }
+                it->id = change.ids[0];
+                it->level = change.level;
+                break;
+            case Change::REMOVE_WORKER:
+                if (it != workers.end())
+                    workers.erase(it);
+                break;
+            case Change::PIN:
+                if (change.day < 1 || change.day > old.days())
+                    throw std::invalid_argument("pinned day must be between 1 and " + std::to_string(old.days()));
+                if (it != workers.end()) {
+                    Days day = day_bit(change.day - 1);
+                    it->pinned_on = change.on_duty ? it->pinned_on | day : it->pinned_on & ~day;
+                    it->pinned_off = change.on_duty ? it->pinned_off & ~day : it->pinned_off | day;
+                }
+                break;
+            case Change::ADD_CONFLICT:
+                conflicts.push_back(change.ids);
+                break;
+            case Change::MIN_DAILY_STAFF:
+                min_daily_staff = change.value;
+                break;
+        }
+    }
+
+    Schedule schedule;
+    schedule.set_weeks(old.weeks);
+    schedule.min_days_off = old.min_days_off;
+    schedule.max_consec_days_off = old.max_consec_days_off;
+    schedule.min_daily_staff = min_daily_staff;
+    schedule.min_daily_seniors = old.min_daily_seniors;
+    schedule.request_weight = old.request_weight;
+    schedule.weekend_weight = old.weekend_weight;
+    schedule.excess_weight = old.excess_weight;
+    for (auto& worker : workers) {
+        int w = schedule.add_worker(worker.id, worker.level);
+        schedule.workers[w].requested_off = worker.requested_off;
+        for (int i = 0; i < schedule.days(); i++) {
+            if (worker.pinned_on >> i & 1)
+                schedule.pin(w, i, true);
+            if (worker.pinned_off >> i & 1)
+                schedule.pin(w, i, false);
+        }
+    }
+    std::vector<std::vector<int>> groups;
+    for (auto& ids : conflicts) {
+        groups.emplace_back();
+        for (auto& id : ids)
+            if (schedule.index.count(id))
+                groups.back().push_back(schedule.index[id]);
+    }
+    schedule.add_conflicts(groups);
+    return schedule;
+}
+
+bool repair(Schedule& schedule, const std::vector<Change>& changes, const SearchOptions& options) {
+    // the previous days on duty of the workers whose days were all decided
+    std::unordered_map<std::string, Days> previous;
+    for (auto& worker : schedule.workers)
+        if ((worker.domain.on ^ worker.domain.off) == schedule.all_days())
+            previous[worker.id] = worker.domain.on & ~worker.domain.off;
+
+    Schedule model = apply_changes(schedule, changes);
+    int n = model.workers.size();
+    Days all_days = model.all_days();
+
+    // the previous schedule tried first, and where it breaks the changed roster
+    std::vector<Days> warm_start(n, 0), freed(n, 0);
+    Days bad_days = 0;
+    for (int w = 0; w < n; w++) {
+        Worker& worker = model.workers[w];
+        auto it = previous.find(worker.id);
+        if (it == previous.end()) { // new worker
+            freed[w] = all_days;
+            continue;
+        }
+        Days on = warm_start[w] = it->second;
+        Days off = all_days & ~on;
+
+        // pinned the other way: his days change, and so does the staff of those days
+        Days moved = (on & worker.pinned_off) | (off & worker.pinned_on);
+        bool fits = moved == 0;
+        bad_days |= moved;
+        for (int k = 0; k < model.weeks; k++)
+            fits = fits && Domain::count(week_days(off, k)) >= model.min_days_off;
+        Days runs = off;
+        for (int i = 1; i < model.max_consec_days_off; i++)
+            runs &= off >> i;
+        fits = fits && runs == 0 && model.max_consec_days_off > 0;
+        if (!fits)
+            freed[w] = all_days;
+    }
+    for (int i = 0; i < model.days(); i++) {
+        int staff = 0, seniors = 0;
+        for (int w = 0; w < n; w++) {
+            staff += warm_start[w] >> i & 1;
+            seniors += (warm_start[w] >> i & 1) && model.workers[w].senior;
+        }
+        if (staff < model.min_daily_staff || seniors < model.min_daily_seniors)
+            bad_days |= day_bit(i);
+    }
+    for (int c = 0; c < model.clique_count(); c++) {
+        // the days two members of the clique work
+        Days working = 0;
+        for (int w : model.members(c)) {
+            bad_days |= working & warm_start[w];
+            working |= warm_start[w];
+        }
+    }
+
+    // search the broken days of every worker, then their whole weeks, then everything
+    SearchOptions local = options;
+    local.warm_start = &warm_start;
+    local.partial = nullptr; // the attempts search copies of the schedule
+    for (int attempt = 0; attempt < 3; attempt++) {
+        std::vector<Days> attempt_freed = freed;
+        Days days = bad_days;
+        if (attempt == 1)
+            for (int k = 0; k < model.weeks; k++)
+                if (week_days(bad_days, k))
+                    days |= (Days)0x7f << (7 * k);
+        for (int w = 0; w < n; w++)
+            attempt_freed[w] = attempt == 2 ? all_days : attempt_freed[w] | days;
+
+        Schedule work = model;
+        if (work.fix_assignment(warm_start, attempt_freed) && scheduler(work, local)) {
+            schedule = work;
+            return true;
+        }
+    }
+    schedule = model;
+    return false;
+}
+
+Change parse_change(const std::string& line) {
+    std::stringstream ss(line);
+    std::string s, id, rest;
+    ss >> s;
+    auto expect = [&](bool ok, const std::string& message) {
+        if (!ok)
+            throw std::invalid_argument(message);
+    };
+    Change change;
+    if (s == "-add-worker") {
+        std::string level;
+        expect(bool(ss >> id >> level), "expected a worker id and a level after -add-worker");
+        change = Change::add_worker(id, level);
+    } else if (s == "-remove-worker") {
+        expect(bool(ss >> id), "expected a worker id after -remove-worker");
+        change = Change::remove_worker(id);
+    } else if (s == "-pin") {
+        int day = 0;
+        std::string value;
+        expect(bool(ss >> id >> day >> value) && day >= 1, "expected a worker id, a day and on|off after -pin");
+        expect(value == "on" || value == "off", "expected on or off after -pin " + id + " " + std::to_string(day));
+        change = Change::pin(id, day, value == "on");
+    } else if (s == "-conflict") {
+        std::vector<std::string> ids;
+        while (ss >> id)
+            ids.push_back(id);
+        expect(!ids.empty(), "expected worker ids after -conflict");
+        return Change::add_conflict(ids);
+    } else if (s == "-min-daily-staff") {
+        int value = 0;
+        expect(bool(ss >> value) && value >= 0, "expected a number after -min-daily-staff");
+        change = Change::min_daily_staff(value);
+    } else
+        throw std::invalid_argument("unknown change " + s);
+    expect(!(ss >> rest), "unexpected " + rest + " after " + s);
+    return change;
+}
+
+/// Reads changes from a file, one per line:
+///               -add-worker worker_id level
+///               -remove-worker worker_id
+///               -pin worker_id day on|off
+///               -conflict worker_id1 worker_id2 ...
+///               -min-daily-staff value
+/// Errors throw a std::runtime_error with the line number.
+std::vector<Change> load_changes(std::string filename) {
+    std::vector<Change> changes;
+    std::ifstream in(filename);
+    if (!in)
+        throw std::runtime_error("cannot open " + filename);
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); line_number++) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        try {
+            changes.push_back(parse_change(line));
+        }
+        catch (const std::invalid_argument& e) {
+            throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": " + e.what());
+        }
+    }
+    return changes;
+}
@@ -0,0 +1,48 @@
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include "scheduler.h"
+
+/// A change to the roster of a solved schedule, see repair()
+struct Change {
+    enum Type { ADD_WORKER, REMOVE_WORKER, PIN, ADD_CONFLICT, MIN_DAILY_STAFF };
+
+    Type type;
+    std::vector<std::string> ids; // the worker, or the conflicting workers
+    std::string level = "";       // ADD_WORKER
+    int day = 0;                  // PIN, from 1 like the day-off requests
+    bool on_duty = false;         // PIN
+    int value = 0;                // MIN_DAILY_STAFF
+
+    static Change add_worker(const std::string& id, const std::string& level) { return { ADD_WORKER, { id }, level }; }
+    static Change remove_worker(const std::string& id)                        { return { REMOVE_WORKER, { id } }; }
+    static Change pin(const std::string& id, int day, bool on_duty)           { return { PIN, { id }, "", day, on_duty }; }
+    static Change add_conflict(const std::vector<std::string>& ids)           { return { ADD_CONFLICT, ids }; }
+    static Change min_daily_staff(int value)                                  { return { MIN_DAILY_STAFF, {}, "", 0, false, value }; }
+};
+
+/// Apply the changes to a solved schedule and repair it, keeping as much of it as possible.
+/// The days of the previous schedule that break no constraint after the changes are kept, and only the others
+/// are searched again: the days of the workers whose week no longer fits, and the days missing staff or
+/// having conflicts, for every worker. When that is not enough the whole weeks of those days are searched,
+/// and then the whole schedule. Every search tries the previous values first.
+/// Returns false when the changed roster has no solution, the schedule then holds the changes but no decision.
+bool repair(Schedule& schedule, const std::vector<Change>& changes, const SearchOptions& options = {});
+
+/// Return the roster of the schedule with the changes applied, every day undecided but the pinned ones.
+Schedule apply_changes(const Schedule& schedule, const std::vector<Change>& changes);
+
+/// Parse a change written like a line of a changes file (see load_changes()).
+/// A line that is not a change, or misses a value, throws a std::invalid_argument.
+Change parse_change(const std::string& line);
+
+/// Reads changes from a file, one per line:
+///               -add-worker worker_id level
+///               -remove-worker worker_id
+///               -pin worker_id day on|off
+///               -conflict worker_id1 worker_id2 ...
+///               -min-daily-staff value
+/// A file that can't be read, or a malformed line, throws a std::runtime_error with the line number.
+std::vector<Change> load_changes(std::string filename);
+
+#endif // REPAIR_H
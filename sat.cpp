@@ -0,0 +1,654 @@
+#include "sat.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// largest bound encoded by a sequential counter, linear in it. Larger ones use a sorting network instead,
+// of O(n log² n) comparators whatever the bound
+const int COUNTER_LIMIT = 16;
+
+/*--------------------------------------------------------- Encoding --------------------------------------------------------*/
+
+std::vector<int> Cnf::sort(const std::vector<int>& literals, bool at_least) {
+    // pad to a power of two with false, 0 standing for it: a comparator with a false input only moves the other one
+    int size = 1;
+    while (size < (int)literals.size())
+        size *= 2;
+    std::vector<int> v = literals;
+    v.resize(size, 0);
+
+    // the larger value goes to the first position
+    auto compare = [&](int i, int j) {
+        if (v[j] == 0)
+            return;
+        if (v[i] == 0) {
+            std::swap(v[i], v[j]);
+            return;
+        }
+        int a = v[i], b = v[j];
+        int high = add_variable(), low = add_variable();
+        if (at_least) { // the outputs imply the inputs
+            add({ -high, a, b });
+            add({ -low, a });
+            add({ -low, b });
+        }
+        else {          // the inputs imply the outputs
+            add({ -a, high });
+            add({ -b, high });
+            add({ -a, -b, low });
+        }
+        v[i] = high;
+        v[j] = low;
+    };
+
+    // Batcher's odd-even merge sort
+    for (int p = 1; p < size; p *= 2)
+        for (int k = p; k >= 1; k /= 2)
+            for (int j = k % p; j + k < size; j += 2 * k)
+                for (int i = 0; i < std::min(k, size - j - k); i++)
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                        compare(i + j, i + j + k);
+    return v;
+}
+
+void Cnf::at_most(const std::vector<int>& literals, int k) {
+    int n = literals.size();
+    if (k >= n)
+        return;
+    if (k < 0) {
+        add({});
+        return;
+    }
+    // the counter of the true literals is smaller than that of the false ones
+    if (n - k < k) {
+        std::vector<int> negated;
+        for (int literal : literals)
+            negated.push_back(-literal);
+        at_least(negated, n - k);
+        return;
+    }
+    if (k == 0) {
+        for (int literal : literals)
+            add({ -literal });
+        return;
+    }
+    if (k > COUNTER_LIMIT) {
+        add({ -sort(literals, false)[k] });
+        return;
+    }
+    // a few literals at most one: every pair, without auxiliary variables
+    if (k == 1 && n <= 6) {
+        for (int i = 0; i < n; i++)
+            for (int j = i + 1; j < n; j++)
+                add({ -literals[i], -literals[j] });
+        return;
+    }
+
+    // sequential counter: counter[j] implied by at least j + 1 of the literals seen so far being true
+    std::vector<int> counter(k), next(k);
+    for (int i = 0; i < n; i++) {
+        int x = literals[i];
+        if (i > 0)
+            add({ -x, -counter[k - 1] });
+        if (i == n - 1)
+            break;
+        for (int j = 0; j < k; j++) {
+            next[j] = add_variable();
+            if (j == 0)
+                add({ -x, next[j] });
+            else if (i > 0)
+                add({ -x, -counter[j - 1], next[j] });
+            if (i > 0)
+                add({ -counter[j], next[j] });
+        }
+        std::swap(counter, next);
+    }
+}
+
+void Cnf::at_least(const std::vector<int>& literals, int k) {
+    int n = literals.size();
+    if (k <= 0)
+        return;
+    if (k > n) {
+        add({});
+        return;
+    }
+    if (n - k < k) {
+        std::vector<int> negated;
+        for (int literal : literals)
+            negated.push_back(-literal);
+        at_most(negated, n - k);
+        return;
+    }
+    if (k > COUNTER_LIMIT) {
+        add({ sort(literals, true)[k - 1] });
+        return;
+    }
+
+    // counter[j] implies at least j of the literals seen so far are true, 0 when it can't be reached
+    // or is no longer needed to reach k
+    std::vector<int> counter(k + 1, 0), next(k + 1, 0);
+    for (int i = 0; i < n; i++) {
+        int x = literals[i];
+        for (int j = std::max(1, k - (n - 1 - i)); j <= std::min(i + 1, k); j++) {
+            next[j] = add_variable();
+            // at least j with x: at least j before, or x and at least j - 1 before
+            std::vector<int> clause = { -next[j] };
+            if (counter[j])
+                clause.push_back(counter[j]);
+            clause.push_back(x);
+            add(clause);
+            if (j > 1) {
+                clause = { -next[j] };
+                if (counter[j])
+                    clause.push_back(counter[j]);
+                clause.push_back(counter[j - 1]);
+                add(clause);
+            }
+        }
+        std::swap(counter, next);
+    }
+    add({ counter[k] });
+}
+
+Cnf encode(const Schedule& schedule, Selectors* selectors) {
+    Cnf cnf;
+    int n = schedule.workers.size(), days = schedule.days();
+    cnf.variables = cnf.inputs = n * days;
+    if (selectors) {
+        selectors->min_days_off = cnf.add_variable();
+        selectors->max_consec_days_off = cnf.add_variable();
+        selectors->min_daily_staff = cnf.add_variable();
+        selectors->min_daily_seniors = cnf.add_variable();
+        selectors->conflicts.clear();
+        for (int c = 0; c < schedule.clique_count(); c++)
+            selectors->conflicts.push_back(cnf.add_variable());
+    }
+
+    // options already removed, by pins, repairs or a previous search
+    for (int w = 0; w < n; w++) {
+        const Domain& domain = schedule.workers[w].domain;
+        for (int i = 0; i < days; i++) {
+            if (!(domain.on >> i & 1))
+                cnf.add({ -duty_variable(schedule, w, i) });
+            if (!(domain.off >> i & 1))
+                cnf.add({ duty_variable(schedule, w, i) });
+        }
+    }
+
+    std::vector<int> literals;
+    for (int w = 0; w < n; w++) {
+        // min_days_off: at least that many days off each week
+        cnf.guard = selectors ? selectors->min_days_off : 0;
+        for (int k = 0; k < schedule.weeks; k++) {
+            literals.clear();
+            for (int i = 7 * k; i < 7 * k + 7; i++)
+                literals.push_back(-duty_variable(schedule, w, i));
+            cnf.at_least(literals, schedule.min_days_off);
+        }
+
+        // max_consec_days_off: a run of that many days off is already too long, so a day on duty
+        // in every window of max_consec_days_off days, across weeks too
+        cnf.guard = selectors ? selectors->max_consec_days_off : 0;
+        if (schedule.max_consec_days_off <= 0) {
+            cnf.add({});
+            continue;
+        }
+        for (int start = 0; start + schedule.max_consec_days_off <= days; start++) {
+            literals.clear();
+            for (int i = start; i < start + schedule.max_consec_days_off; i++)
+                literals.push_back(duty_variable(schedule, w, i));
+            cnf.add(literals);
+        }
+    }
+
+    // conflicts: at most one member of each clique on duty each day
+    for (int c = 0; c < schedule.clique_count(); c++)
+        for (int i = 0; i < days; i++) {
+            cnf.guard = selectors ? selectors->conflicts[c] : 0;
+            literals.clear();
+            for (int w : schedule.members(c))
+                literals.push_back(duty_variable(schedule, w, i));
+            cnf.at_most(literals, 1);
+        }
+
+    // min_daily_staff and min_daily_seniors: at least that many workers, and seniors, on duty each day
+    for (int i = 0; i < days; i++) {
+        literals.clear();
+        for (int w = 0; w < n; w++)
+            literals.push_back(duty_variable(schedule, w, i));
+        cnf.guard = selectors ? selectors->min_daily_staff : 0;
+        cnf.at_least(literals, schedule.min_daily_staff);
+
+        literals.clear();
+        for (int w = 0; w < n; w++)
+            if (schedule.workers[w].senior)
+                literals.push_back(duty_variable(schedule, w, i));
+        cnf.guard = selectors ? selectors->min_daily_seniors : 0;
+        cnf.at_least(literals, schedule.min_daily_seniors);
+    }
+    cnf.guard = 0;
+    return cnf;
+}
+
+void write_dimacs(const Cnf& cnf, std::ostream& out) {
+    out << "p cnf " << cnf.variables << " " << cnf.clauses.size() << "\n";
+    for (auto& clause : cnf.clauses) {
+        for (int literal : clause)
+            out << literal << " ";
+        out << "0\n";
+    }
+}
+
+/*---------------------------------------------------------- Solver ---------------------------------------------------------*/
+
+/// the literal codes of DIMACS literals, and back
+static int code(int literal) { return 2 * std::abs(literal) + (literal < 0); }
+static int literal(int code) { return code & 1 ? -(code >> 1) : code >> 1; }
+
+/// Conflict driven clause learning solver. Literals are coded 2 * variable + negated,
+/// so that the negation of a code is code ^ 1.
+struct Solver {
+    int n;                                  // number of variables, numbered from 1
+    int inputs;                             // variables decided before the others, see Cnf::inputs
+    std::vector<std::vector<int>> clauses;  // literal codes of each clause, the first two are watched
+    std::vector<int> lbd;                   // clause -> distinct levels when learned, 0 for an input clause
+    std::vector<uint8_t> deleted;           // clause -> forgotten by reduce()
+    std::vector<std::vector<int>> watches;  // literal code -> clauses watching it
+    std::vector<int8_t> value;              // variable -> 1 true, 0 false, -1 unassigned
+    std::vector<int> level, reason;         // variable -> decision level and implying clause (-1 for none)
+    std::vector<int> trail;                 // assigned literal codes, in order
+    std::vector<int> trail_lim;             // decision level - 1 -> trail size before its decision
+    size_t qhead = 0;                       // trail entries already propagated
+
+    // VSIDS: the unassigned variable of highest activity is decided next, with its last value
+    std::vector<double> activity;
+    double increment = 1;
+    Heap heap;
+    std::vector<uint8_t> phase;
+    std::vector<uint8_t> seen;              // variable -> visited, scratch of analyze()
+
+    long long decisions = 0, conflicts = 0, learned = 0;
+    bool inconsistent = false;              // an input clause is empty or falsified by the units
+
+    explicit Solver(const Cnf& cnf) : n(cnf.variables), inputs(cnf.inputs) {
+        watches.resize(2 * n + 2);
+        value.assign(n + 1, -1);
+        level.assign(n + 1, 0);
+        reason.assign(n + 1, -1);
+        activity.assign(n + 1, 0);
+        phase.assign(n + 1, 0); // off duty first, like the search
+        seen.assign(n + 1, 0);
+        heap.clear(n + 1);
+        for (int v = 1; v <= n; v++)
+            heap.update(v, key(v));
+
+        std::vector<int> codes;
+        for (auto& clause : cnf.clauses) {
+            codes.clear();
+            for (int literal : clause)
+                codes.push_back(code(literal));
+            std::sort(codes.begin(), codes.end());
+            codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+            bool tautology = false;
+            for (size_t i = 1; i < codes.size(); i++)
+                tautology |= codes[i] == (codes[i - 1] ^ 1);
+            if (tautology)
+                continue;
+            if (codes.empty())
+                inconsistent = true;
+            else if (codes.size() == 1) {
+                if (literal_value(codes[0]) == 0)
+                    inconsistent = true;
+                else if (literal_value(codes[0]) == -1)
+                    assign(codes[0], -1);
+            }
+            else
+                attach(codes, 0);
+        }
+    }
+
+    int literal_value(int code) const {
+        int v = value[code >> 1];
+        return v < 0 ? -1 : v ^ (code & 1);
+    }
+    int decision_level() const { return trail_lim.size(); }
+    /// heap key of the variable: the inputs first, then the most active on top.
+    /// Non negative doubles order like their bits, which leave the top bit clear
+    uint64_t key(int v) const {
+        uint64_t bits;
+        std::memcpy(&bits, &activity[v], sizeof(bits));
+        return (uint64_t)(v > inputs) << 63 | (INT64_MAX - bits);
+    }
+
+    void assign(int code, int from) {
+        int v = code >> 1;
+        value[v] = !(code & 1);
+        level[v] = decision_level();
+        reason[v] = from;
+        trail.push_back(code);
+    }
+
+    int attach(const std::vector<int>& codes, int clause_lbd) {
+        int c = clauses.size();
+        clauses.push_back(codes);
+        lbd.push_back(clause_lbd);
+        deleted.push_back(0);
+        watches[codes[0]].push_back(c);
+        watches[codes[1]].push_back(c);
+        return c;
+    }
+
+    /// propagate the trail through the watched literals, return the falsified clause or -1
+    int propagate() {
+        while (qhead < trail.size()) {
+            int falsified = trail[qhead++] ^ 1;
+            std::vector<int>& watching = watches[falsified];
+            size_t i = 0, j = 0;
+            while (i < watching.size()) {
+                int c = watching[i++];
+                if (deleted[c])
+                    continue;
+                std::vector<int>& clause = clauses[c];
+                if (clause[0] == falsified)
+                    std::swap(clause[0], clause[1]);
+                if (literal_value(clause[0]) == 1) {
+                    watching[j++] = c;
+                    continue;
+                }
+                // watch another literal that is not false
+                bool moved = false;
+                for (size_t k = 2; k < clause.size(); k++)
+                    if (literal_value(clause[k]) != 0) {
+                        std::swap(clause[1], clause[k]);
+                        watches[clause[1]].push_back(c);
+                        moved = true;
+                        break;
+                    }
+                if (moved)
+                    continue;
+                watching[j++] = c;
+                if (literal_value(clause[0]) == 0) {
+                    while (i < watching.size())
+                        watching[j++] = watching[i++];
+                    watching.resize(j);
+                    return c;
+                }
+                assign(clause[0], c);
+            }
+            watching.resize(j);
+        }
+        return -1;
+    }
+
+    void bump(int v) {
+        activity[v] += increment;
+        if (activity[v] > 1e100) {
+            for (int u = 1; u <= n; u++)
+                activity[u] *= 1e-100;
+            increment *= 1e-100;
+            for (int u = 1; u <= n; u++)
+                if (heap.contains(u))
+                    heap.update(u, key(u));
+        }
+        if (heap.contains(v))
+            heap.update(v, key(v));
+    }
+
+    /// first UIP learning: fill the learned clause, its asserting literal first, and return the level to go back to
+    int analyze(int confl, std::vector<int>& learnt) {
+        learnt.assign(1, -1);
+        int pending = 0, p = -1;
+        int index = trail.size() - 1;
+        do {
+            std::vector<int>& clause = clauses[confl];
+            for (size_t k = p == -1 ? 0 : 1; k < clause.size(); k++) {
+                int v = clause[k] >> 1;
+                if (seen[v] || level[v] == 0)
+                    continue;
+                seen[v] = 1;
+                bump(v);
+                if (level[v] == decision_level())
+                    pending++;
+                else
+                    learnt.push_back(clause[k]);
+            }
+            while (!seen[trail[index] >> 1])
+                index--;
+            p = trail[index--];
+            confl = reason[p >> 1];
+            seen[p >> 1] = 0;
+            pending--;
+        } while (pending > 0);
+        learnt[0] = p ^ 1;
+
+        // drop the literals implied by the others
+        size_t kept = 1;
+        for (size_t k = 1; k < learnt.size(); k++) {
+            int r = reason[learnt[k] >> 1];
+            bool redundant = r != -1;
+            if (redundant)
+                for (size_t m = 1; m < clauses[r].size(); m++) {
+                    int u = clauses[r][m] >> 1;
+                    if (!seen[u] && level[u] > 0) {
+                        redundant = false;
+                        break;
+                    }
+                }
+            if (!redundant)
+                std::swap(learnt[kept++], learnt[k]); // the dropped ones stay behind, to be unmarked
+        }
+        for (size_t k = 1; k < learnt.size(); k++)
+            seen[learnt[k] >> 1] = 0;
+        learnt.resize(kept);
+
+        // watch the literal of the highest level after the asserting one
+        int back = 0;
+        for (size_t k = 1; k < learnt.size(); k++)
+            if (level[learnt[k] >> 1] > back) {
+                back = level[learnt[k] >> 1];
+                std::swap(learnt[1], learnt[k]);
+            }
+        return back;
+    }
+
+    int literal_block_distance(const std::vector<int>& codes) {
+        std::vector<int> levels;
+        for (int code : codes)
+            levels.push_back(level[code >> 1]);
+        std::sort(levels.begin(), levels.end());
+        return std::unique(levels.begin(), levels.end()) - levels.begin();
+    }
+
+    void backtrack(int target) {
+        if (decision_level() <= target)
+            return;
+        for (size_t k = trail_lim[target]; k < trail.size(); k++) {
+            int v = trail[k] >> 1;
+            phase[v] = value[v];
+            value[v] = -1;
+            reason[v] = -1;
+            heap.update(v, key(v));
+        }
+        trail.resize(trail_lim[target]);
+        trail_lim.resize(target);
+        qhead = trail.size();
+    }
+
+    /// forget the less useful half of the learned clauses, keeping those of LBD 2 and the reasons
+    void reduce() {
+        std::vector<int> candidates;
+        for (int c = 0; c < (int)clauses.size(); c++) {
+            if (deleted[c] || lbd[c] <= 2)
+                continue;
+            int v = clauses[c][0] >> 1;
+            if (reason[v] == c && value[v] != -1)
+                continue;
+            candidates.push_back(c);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+            return lbd[a] != lbd[b] ? lbd[a] > lbd[b] : clauses[a].size() > clauses[b].size();
+        });
+        for (size_t k = 0; k < candidates.size() / 2; k++) {
+            deleted[candidates[k]] = 1;
+            std::vector<int>().swap(clauses[candidates[k]]);
+        }
+    }
+
+    /// the Luby sequence 1 1 2 1 1 2 4 ..., scaling the conflicts between restarts
+    static long long luby(int x) {
+        int size = 1, sequence = 0;
+        while (size < x + 1) {
+            sequence++;
+            size = 2 * size + 1;
+        }
+        while (size - 1 != x) {
+            size = (size - 1) >> 1;
+            sequence--;
+            x = x % size;
+        }
+        return 1LL << sequence;
+    }
+
+    /// the assumptions that imply the negation of the given one, which failed, and that one
+    void analyze_final(int failed, std::vector<int>& core) {
+        core.assign(1, failed);
+        if (decision_level() == 0)
+            return;
+        seen[failed >> 1] = 1;
+        for (int k = trail.size() - 1; k >= trail_lim[0]; k--) {
+            int v = trail[k] >> 1;
+            if (!seen[v])
+                continue;
+            seen[v] = 0;
+            if (reason[v] == -1) // below the assumptions, every decision is one
+                core.push_back(trail[k]);
+            else
+                for (size_t m = 1; m < clauses[reason[v]].size(); m++)
+                    if (level[clauses[reason[v]][m] >> 1] > 0)
+                        seen[clauses[reason[v]][m] >> 1] = 1;
+        }
+        seen[failed >> 1] = 0;
+    }
+
+    /// Search for a model extending the assumptions (literal codes), decided first, each at a level of its own.
+    /// When they are refuted, core is set to those involved
+    int solve(const SearchOptions& options, const std::vector<int>& assumptions = {}, std::vector<int>* core = nullptr) {
+        backtrack(0);
+        if (core)
+            core->clear();
+        if (inconsistent || propagate() != -1) {
+            inconsistent = true;
+            return 0;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.time_limit);
+        int restarts = 0;
+        long long restart_conflicts = 100 * luby(0), since_restart = 0;
+        size_t max_learned = std::max<size_t>(2000, clauses.size() / 3), live_learned = 0;
+        std::vector<int> learnt;
+        while (true) {
+            int confl = propagate();
+            if (confl != -1) {
+                conflicts++;
+                since_restart++;
+                if (decision_level() == 0) {
+                    inconsistent = true;
+                    return 0;
+                }
+                int back = analyze(confl, learnt);
+                backtrack(back);
+                if (learnt.size() == 1)
+                    assign(learnt[0], -1);
+                else {
+                    int c = attach(learnt, literal_block_distance(learnt));
+                    assign(learnt[0], c);
+                    learned++;
+                    live_learned++;
+                }
+                increment /= 0.95;
+
+                if ((conflicts & 255) == 0 && ((options.stop && *options.stop) ||
+                    (options.time_limit > 0 && std::chrono::steady_clock::now() > deadline)))
+                    return -1;
+                if (since_restart >= restart_conflicts) {
+                    backtrack(0);
+                    since_restart = 0;
+                    restart_conflicts = 100 * luby(++restarts);
+                }
+                if (live_learned >= max_learned) {
+                    reduce();
+                    live_learned /= 2;
+                    max_learned += max_learned / 10;
+                }
+                continue;
+            }
+
+            // decide the next assumption, or else the most active unassigned variable
+            int next = -1;
+            while (next == -1 && decision_level() < (int)assumptions.size()) {
+                int code = assumptions[decision_level()];
+                if (literal_value(code) == 0) {
+                    if (core)
+                        analyze_final(code, *core);
+                    return 0;
+                }
+                if (literal_value(code) == 1)
+                    trail_lim.push_back(trail.size()); // holds already, an empty level
+                else
+                    next = code;
+            }
+            while (next == -1 && heap.top() != -1) {
+                int top = heap.top();
+                heap.erase(top);
+                if (value[top] == -1)
+                    next = 2 * top + !phase[top];
+            }
+            if (next == -1)
+                return 1;
+            if (options.node_limit > 0 && decisions >= options.node_limit)
+                return -1;
+            decisions++;
+            trail_lim.push_back(trail.size());
+            assign(next, -1);
+        }
+    }
+};
+
+int solve_cnf(const Cnf& cnf, std::vector<bool>& model, const SearchOptions& options, Stats* stats) {
+    Solver solver(cnf);
+    int result = solver.solve(options);
+    if (result == 1) {
+        model.assign(cnf.variables + 1, false);
+        for (int v = 1; v <= cnf.variables; v++)
+            model[v] = solver.value[v] == 1;
+    }
+    if (stats) {
+        stats->nodes += solver.decisions;
+        stats->backtracks += solver.conflicts;
+        stats->learned += solver.learned;
+    }
+    return result;
+}
+
+IncrementalSolver::IncrementalSolver(const Cnf& cnf) : solver(std::make_unique<Solver>(cnf)) {}
+
+IncrementalSolver::~IncrementalSolver() = default;
+
+int IncrementalSolver::solve(const std::vector<int>& assumptions, std::vector<int>& core, const SearchOptions& options,
+                             Stats* stats) {
+    long long decisions = solver->decisions, conflicts = solver->conflicts, learned = solver->learned;
+    std::vector<int> codes;
+    for (int l : assumptions)
+        codes.push_back(code(l));
+    int result = solver->solve(options, codes, &core);
+    for (int& l : core)
+        l = literal(l);
+    if (stats) {
+        stats->nodes += solver->decisions - decisions;
+        stats->backtracks += solver->conflicts - conflicts;
+        stats->learned += solver->learned - learned;
+    }
+    return result;
+}
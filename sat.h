@@ -0,0 +1,82 @@
+#ifndef SAT_H
+#define SAT_H
+
+#include "scheduler.h"
+
+#include <ostream>
+#include <memory>
+
+/// Formula in conjunctive normal form. Variables are numbered from 1, a literal is a variable or its negation.
+struct Cnf {
+    int variables = 0;
+    int inputs = 0; // variables 1 to inputs are those of the problem, the others encode the constraints over them
+    std::vector<std::vector<int>> clauses = {};
+    int guard = 0;  // when set, a variable added negated to every clause: they only hold when it is true
+
+    int add_variable() { return ++variables; }
+    void add(std::vector<int> clause) {
+        if (guard)
+            clause.push_back(-guard);
+        clauses.push_back(std::move(clause));
+    }
+    /// at most k of the literals are true, counting the true literals or the false ones, whichever is fewer:
+    /// with a sequential counter for small bounds, otherwise with a sorting network
+    void at_most(const std::vector<int>& literals, int k);
+    /// at least k of the literals are true, encoded like at_most()
+    void at_least(const std::vector<int>& literals, int k);
+
+private:
+    /// outputs of a sorting network over the literals, true ones first (0 for false padding).
+    /// With at_least, an output true implies that many inputs true, otherwise the converse
+    std::vector<int> sort(const std::vector<int>& literals, bool at_least);
+};
+
+/// variable of the worker being on duty the given day
+inline int duty_variable(const Schedule& schedule, int worker, int day) { return worker * schedule.days() + day + 1; }
+
+/// Selector variables of the constraints of a formula, see encode()
+struct Selectors {
+    int min_days_off = 0;
+    int max_consec_days_off = 0;
+    int min_daily_staff = 0;
+    int min_daily_seniors = 0;
+    std::vector<int> conflicts = {}; // clique -> its selector
+};
+
+/// Encode the schedule as a formula over the duty variables, then auxiliary ones:
+/// the options already removed as units, the minimum days off of each week and the minimum daily staff
+/// and seniors as cardinality constraints, the maximum consecutive days off as one clause per window of days,
+/// and each conflict clique as at most one on duty per day.
+/// With selectors, each of these constraints but the units is guarded by a selector variable of its own,
+/// numbered right after the inputs: it holds when its selector is assumed true, see IncrementalSolver.
+Cnf encode(const Schedule& schedule, Selectors* selectors = nullptr);
+
+/// write the formula in the DIMACS format
+void write_dimacs(const Cnf& cnf, std::ostream& out);
+
+/// Solve the formula by conflict driven clause learning: two watched literals, first UIP learning,
+/// VSIDS branching with phase saving, Luby restarts and clause deletion by LBD.
+/// The input variables are decided before the auxiliary ones.
+/// Fills model (variable -> value, from 1) and returns 1 when satisfiable, 0 when not, and -1 when
+/// options.stop, options.time_limit or options.node_limit (counting decisions) ended the search first. Decisions, conflicts and learned clauses
+/// are added to the stats as nodes, backtracks and learned nogoods.
+int solve_cnf(const Cnf& cnf, std::vector<bool>& model, const SearchOptions& options, Stats* stats = nullptr);
+
+struct Solver;
+
+/// A formula loaded once in the solver of solve_cnf(), then solved under different assumptions,
+/// the clauses learned by a solve being kept for the next ones.
+struct IncrementalSolver {
+    explicit IncrementalSolver(const Cnf& cnf);
+    ~IncrementalSolver();
+
+    /// Solve with the given literals assumed true, returning as solve_cnf(). When it returns 0, core holds
+    /// the assumptions refuted together, a subset of them (none when the formula has no solution anyway).
+    int solve(const std::vector<int>& assumptions, std::vector<int>& core, const SearchOptions& options,
+              Stats* stats = nullptr);
+
+private:
+    std::unique_ptr<Solver> solver;
+};
+
+#endif // SAT_H
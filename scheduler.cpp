@@ -1,385 +1,1779 @@
 #include "scheduler.h"
+#include "parallel.h"
+#include "lns.h"
 
-/// Return the worker that have a non-zero but least number of available options in his domain.
-/// When the returned worker domain is empty, it means that all the workers domain are empty too.
-std::string mrv(std::unordered_map<std::string, Worker>& workers) { // minimun remaining values
-    std::string mrv_id;
-    for (auto& p : workers) {
-        if (mrv_id.empty()) mrv_id = p.first;
-        else {
-            int rv_count = Domain::count(p.second.domain.on) + Domain::count(p.second.domain.off);
-            int mrv_count = Domain::count(workers[mrv_id].domain.on) + Domain::count(workers[mrv_id].domain.off);
+#include <chrono>
+#include <charconv>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char* const CONSTRAINT_NAMES[CONSTRAINT_TYPES] = {
+    "min_days_off", "max_consec_days_off", "min_daily_staff", "conflicts", "symmetry", "patterns", "nogoods"
+};
+
+thread_local long long heap_allocations = 0;
+bool allocations_counted = false;
 
-            if (mrv_count == 0 || (rv_count != 0 && rv_count < mrv_count))
-                mrv_id = p.first;
+/// What the row constraints need to know of each of the 128 patterns of a week, bit i set when on duty the ith day
+struct WeekPatterns {
+    uint8_t days_off[128]     = {}; // number of days off
+    uint8_t longest_off[128]  = {}; // longest run of days off
+    uint8_t leading_off[128]  = {}; // days off before the first day on duty
+    uint8_t trailing_off[128] = {}; // days off after the last day on duty
+};
+
+static constexpr WeekPatterns make_week_patterns() {
+    WeekPatterns table;
+    for (int p = 0; p < 128; p++) {
+        int run = 0;
+        for (int i = 0; i < 7; i++) {
+            bool off = !(p >> i & 1);
+            run = off ? run + 1 : 0;
+            table.days_off[p] += off;
+            if (run > table.longest_off[p])
+                table.longest_off[p] = run;
+            if (run == i + 1)
+                table.leading_off[p] = run;
         }
+        table.trailing_off[p] = run;
+    }
+    return table;
+}
+
+static constexpr WeekPatterns WEEK_PATTERNS = make_week_patterns();
+
+/// Mix the seed with a value, used to break ties and order values in seeded searches
+static unsigned hash(unsigned seed, unsigned value) {
+    unsigned h = seed * 0x9e3779b9u ^ value * 0x85ebca6bu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+/// Return the worker that have a non-zero but least number of available options in his domain,
+/// breaking ties by the number of workers he has conflicts with.
+/// When no worker has options left, return -1: every day of every worker is decided.
+/// Takes the top of schedule.heap, which must have been built.
+int mrv(Schedule& schedule) { // minimun remaining values
+    // the heap only holds workers with undecided days, keyed by their number
+    return schedule.heap.top();
+}
+
+/// Search levels of the decisions a failure follows from, sorted, kept in Schedule::level_stack.
+/// The levels a search node collects are followed there by those of the node below it, as on a stack,
+/// so that a search allocates nothing once the stack has grown as deep as its failures.
+struct Levels {
+    std::vector<int>& stack;
+    size_t start;
+    size_t size = 0;
+    bool all = false;   // every decision on the way to the failure, without listing them
+
+    Levels(std::vector<int>& stack, size_t start) : stack(stack), start(start) {}
+    /// the levels of a failure below this one, stored after it
+    Levels below() { return Levels(stack, start + size); }
+
+    int* begin() const { return stack.data() + start; }
+    int* end()   const { return stack.data() + start + size; }
+    void clear() { size = 0; all = false; }
+    bool contains(int l) const { return all || std::binary_search(begin(), end(), l); }
+    void push_back(int l) {
+        reserve(start + size + 1);
+        stack[start + size++] = l;
+    }
+    /// take the levels of a failure below this one
+    void assign(const Levels& other) {
+        std::copy(other.begin(), other.end(), begin());
+        size = other.size;
+        all = other.all;
+    }
+    /// add the levels of the failure right below this one
+    void merge(const Levels& other) {
+        all |= other.all;
+        // united after both, then moved down
+        size_t united = other.start + other.size;
+        reserve(united + size + other.size);
+        size = std::set_union(begin(), end(), other.begin(), other.end(), stack.begin() + united) - stack.begin() - united;
+        std::copy(stack.begin() + united, stack.begin() + united + size, begin());
+    }
+
+private:
+    void reserve(size_t n) {
+        if (n > stack.size())
+            stack.resize(std::max(n, 2 * stack.size()));
+    }
+};
+
+/// Best schedule found by an optimizing search, see SearchOptions::optimize
+struct Incumbent {
+    long long cost = LLONG_MAX;     // only cheaper schedules are searched for
+    bool found = false;
+    size_t root = 0;                // trail size once the root is propagated
+    std::vector<Removal> removals;  // the trail from the root to the best schedule
+};
+
+/// Limits of a search, see SearchOptions::time_limit and node_limit, and its deepest node so far
+struct Budget {
+    std::chrono::steady_clock::time_point deadline;
+    bool limited = false;           // the search must stop at the deadline
+    long long nodes = 0;            // nodes visited
+    long long node_limit = 0;       // nodes before stopping, 0 for no limit
+    bool exhausted = false;         // the deadline or the node limit has passed, or enough schedules were enumerated
+    long long solutions = 0;        // schedules enumerated, see SearchOptions::solutions
+    bool track = false;             // record the deepest node, see SearchOptions::partial
+    size_t deepest = 0;             // trail size of the deepest node, the one deciding the most days
+    std::vector<Removal> path;      // the decisions leading to it
+};
+
+/// Split the workers in parts the search can solve one after the other: no constraint links two parts.
+/// The daily minimums link every worker, so there is a single part unless they are 0.
+/// Returns no part when the workers can't be split.
+static std::vector<std::vector<int>> components(Schedule& schedule, const SearchOptions& options) {
+    std::vector<std::vector<int>> parts;
+    int n = schedule.workers.size();
+    // a cost limit bounds the sum of the parts, which are optimized apart,
+    // and each enumerated schedule combines a schedule of every part
+    if (schedule.min_daily_staff > 0 || schedule.min_daily_seniors > 0 || n < 2 ||
+            (options.optimize && options.cost_limit != LLONG_MAX) || (options.solutions > 0 && !options.optimize))
+        return parts;
+
+    // union find over the cliques and the symmetry chains
+    std::vector<int> root(n);
+    for (int w = 0; w < n; w++)
+        root[w] = w;
+    auto find = [&](int w) {
+        while (root[w] != w)
+            w = root[w] = root[root[w]];
+        return w;
+    };
+    for (int c = 0; c < schedule.clique_count(); c++)
+        for (int w : schedule.members(c))
+            root[find(w)] = find(*schedule.members(c).begin());
+    for (int w = 0; w < n; w++)
+        if (schedule.symmetric(w) && schedule.symmetric_next[w] != -1)
+            root[find(schedule.symmetric_next[w])] = find(w);
+
+    std::vector<int> part(n, -1);
+    for (int w = 0; w < n; w++) {
+        int r = find(w);
+        if (part[r] == -1) {
+            part[r] = parts.size();
+            parts.emplace_back();
+        }
+        parts[part[r]].push_back(w);
+    }
+    if (parts.size() == 1)
+        parts.clear();
+    return parts;
+}
+
+/// recursive search of scheduler(), on a schedule whose heap is built.
+/// On failure, conflict holds the levels of the decisions that caused it (when backjumping).
+/// When optimizing, every schedule better than the incumbent is recorded and the search goes on,
+/// failing the nodes whose cost bound can't improve on it. When enumerating, every schedule is passed on
+/// and the search goes on likewise, until there are enough of them.
+static bool search(Schedule& schedule, const SearchOptions& options, Levels& conflict, Budget& budget,
+                   Incumbent* incumbent);
+
+/// Put the schedule, at the root of the search, back in the deepest node the budget recorded,
+/// and report it with the constraints failing both values of the next day to decide.
+static void restore_deepest(Schedule& schedule, const Budget& budget, Partial& partial) {
+    schedule.backjump = false;
+    for (auto& r : budget.path) {
+        schedule.reason = -1;
+        if (!Constraint::prune(schedule, r.worker, r.day, r.on_duty) || !Constraint::propagate(schedule))
+            break; // the nogoods pruned more during the search, stop at the last consistent node
+    }
+
+    partial = Partial();
+    for (auto& worker : schedule.workers)
+        partial.decided += Domain::count((worker.domain.on ^ worker.domain.off) & schedule.all_days());
+    partial.worker = mrv(schedule);
+    if (partial.worker == -1)
+        return;
+    Domain& domain = schedule.workers[partial.worker].domain;
+    partial.day = first_day(domain.on & domain.off);
+    for (bool on_duty : { true, false }) {
+        size_t mark = schedule.trail.size();
+        schedule.reason = -1;
+        if (!Constraint::prune(schedule, partial.worker, partial.day, !on_duty) || !Constraint::propagate(schedule))
+            (on_duty ? partial.blocking_on : partial.blocking_off) = schedule.failure;
+        schedule.undo(mark);
     }
-    return mrv_id;
 }
 
 /// solve scheduling problem using MRV, Forward Checking, and Constriant Propagation to optimize the solution
-bool scheduler(Schedule& schedule) {
-    if (schedule.workers.empty())
-        return true;
+bool scheduler(Schedule& schedule, const SearchOptions& options) {
+    if (options.lns > 0)
+        return lns_scheduler(schedule, options);
+    if (options.threads > 1 && !options.optimize)
+        return parallel_scheduler(schedule, options);
+
+    // chains set up by the caller are kept, see parallel_scheduler()
+    bool chain = options.symmetry && schedule.symmetric_next.empty();
+    if (chain)
+        schedule.chain_symmetries();
+    schedule.build_heap(options.seed);
+    schedule.recount_cost();
+    schedule.stats = options.stats;
+    schedule.patterns = options.patterns;
+    // the removals already on the trail are facts for this search,
+    // so are the nogoods learned from them: they are forgotten once it is over
+    schedule.backjump = options.backjump;
+    schedule.max_nogoods = options.backjump ? std::max(options.nogoods, 0) : 0;
+    schedule.nogood_head = schedule.trail.size();
+
+    Incumbent incumbent;
+    incumbent.cost = options.cost_limit;
+    Budget budget;
+    budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.time_limit);
+    budget.limited = options.time_limit > 0;
+    budget.node_limit = std::max(options.node_limit, 0LL);
+    budget.track = options.partial != nullptr;
+
+    // size everything the search grows for the deepest search possible, each option of each day removed
+    size_t cells = schedule.workers.size() * schedule.days();
+    schedule.trail.reserve(2 * cells);
+    schedule.decisions.reserve(cells);
+    schedule.conflict.reserve(2 * cells);
+    schedule.reserve_queue(schedule.workers.size() * (CONSTRAINT_TYPES + schedule.days()) + schedule.days());
+    schedule.nogoods.reserve(std::min<size_t>(schedule.max_nogoods, 1 << 16)); // larger stores grow as they fill
+    schedule.watches.resize(2 * cells, -1);
+    schedule.level_stack.resize(std::max({ schedule.level_stack.size(), 8 * cells, (size_t)4096 }));
+    schedule.seen.resize(2 * cells, 0);
+    if (options.optimize)
+        incumbent.removals.reserve(2 * cells);
+    if (budget.track)
+        budget.path.reserve(cells);
+
+    Levels conflict(schedule.level_stack, 0);
+    bool success = Constraint::propagate_all(schedule);
+
+    // the independent parts are searched one after the other, the decisions of each becoming facts for the next
+    std::vector<std::vector<int>> parts = components(schedule, options);
+    for (size_t k = 0; success && k < std::max<size_t>(1, parts.size()); k++) {
+        if (!parts.empty())
+            schedule.build_heap(options.seed, &parts[k]);
+        incumbent.root = schedule.trail.size();
+        incumbent.found = false;
+        incumbent.cost = options.cost_limit;
+        budget.deepest = 0;
+        budget.path.clear();
+        long long allocated = heap_allocations;
+        success = search(schedule, options, conflict, budget, options.optimize ? &incumbent : nullptr);
+        if (schedule.stats)
+            schedule.stats->allocations += heap_allocations - allocated;
+
+        if (options.optimize && incumbent.found) {
+            // the search undid everything, put the best schedule back
+            schedule.undo(incumbent.root);
+            for (auto& r : incumbent.removals)
+                schedule.remove(r.worker, r.day, r.on_duty);
+            schedule.clear_queue();
+            success = true;
+        }
+        // the schedules were passed on as they were found
+        if (options.solutions > 0 && !options.optimize && budget.solutions > 0)
+            success = true;
+        // the nogoods of a part are about its own workers, and bounded by its own best cost
+        schedule.decisions.clear();
+        schedule.clear_nogoods();
+        schedule.nogood_head = schedule.trail.size();
+
+        // out of budget without a schedule: leave the schedule in the deepest node, for the caller to report
+        if (!success && budget.exhausted && options.partial) {
+            restore_deepest(schedule, budget, *options.partial);
+            schedule.decisions.clear();
+            schedule.nogood_head = schedule.trail.size();
+        }
+    }
+    if (options.complete)
+        *options.complete = !budget.exhausted && !(options.stop && options.stop->load()) &&
+                            !(options.outer_stop && options.outer_stop->load());
+    schedule.stats = nullptr;
+    schedule.patterns = false;
+    schedule.backjump = false;
+    schedule.decisions.clear();
+    schedule.clear_nogoods();
+    if (chain) {
+        schedule.symmetric_prev.clear();
+        schedule.symmetric_next.clear();
+    }
+    return success;
+}
+
+/// collect the levels of the decisions the removals in schedule.conflict follow from,
+/// using up schedule.conflict as the stack of the removals left to visit
+static void analyze(Schedule& schedule, Levels& levels) {
+    if (++schedule.analysis == 0) { // the stamps wrapped around
+        std::fill(schedule.seen.begin(), schedule.seen.end(), 0);
+        schedule.analysis = 1;
+    }
+    std::vector<int>& pending = schedule.conflict;
+    while (!pending.empty()) {
+        int i = pending.back();
+        pending.pop_back();
+        if (schedule.seen[i] == schedule.analysis)
+            continue;
+        schedule.seen[i] = schedule.analysis;
+
+        int level = schedule.level(i);
+        if (level == 0) // holds whatever the decisions
+            continue;
+        if (schedule.trail[i].reason == -1) // the decision of the level, met once
+            levels.push_back(level);
+        else
+            Constraint::explain(schedule, i, pending);
+    }
+    std::sort(levels.begin(), levels.end());
+}
+
+/// store the decisions of the given levels as a nogood, the deepest ones watched
+static void learn(Schedule& schedule, const Levels& levels) {
+    int size = levels.all ? schedule.decisions.size() : levels.size;
+    if (size > MAX_NOGOOD_SIZE || schedule.max_nogoods == 0)
+        return;
+    int literals[MAX_NOGOOD_SIZE];
+    for (int k = 0; k < size; k++) {
+        int level = levels.all ? size - k : levels.begin()[size - 1 - k];
+        const Removal& r = schedule.trail[schedule.decisions[level - 1]];
+        literals[k] = schedule.literal(r.worker, r.day, r.on_duty);
+    }
+    schedule.add_nogood({ literals, literals + size });
+    if (schedule.stats)
+        schedule.stats->learned++;
+}
+
+static bool search(Schedule& schedule, const SearchOptions& options, Levels& conflict, Budget& budget,
+                   Incumbent* incumbent) {
+    conflict.clear();
+    // another search already finished
+    if ((options.stop && options.stop->load(std::memory_order_relaxed)) ||
+            (options.outer_stop && options.outer_stop->load(std::memory_order_relaxed)))
+        return false;
+    // out of time or nodes: give up, unwinding without trying the other values.
+    // The empty conflict makes the backjumping skip them, and learn nothing
+    if (budget.exhausted || (budget.node_limit > 0 && budget.nodes >= budget.node_limit) ||
+            (budget.limited && std::chrono::steady_clock::now() > budget.deadline)) {
+        budget.exhausted = true;
+        return false;
+    }
+    budget.nodes++;
+    // bound: the cost can only grow as more days are decided
+    if (incumbent && schedule.cost >= incumbent->cost) {
+        conflict.all = true; // failing whatever the decisions
+        return false;
+    }
+    if (schedule.stats)
+        schedule.stats->nodes++;
+    if (budget.track && schedule.trail.size() > budget.deepest) {
+        budget.deepest = schedule.trail.size();
+        budget.path.clear();
+        for (size_t index : schedule.decisions)
+            budget.path.push_back(schedule.trail[index]);
+    }
 
     // get the worker with the least number of available options (MRV)
-    std::string worker_id = mrv(schedule.workers);
-    Worker& worker = schedule.workers[worker_id];
+    int worker = mrv(schedule);
+
+    // all workers days are decided, found a solution
+    if (worker == -1) {
+        if (incumbent) {
+            // keep it and look for a better one
+            incumbent->cost = schedule.cost;
+            incumbent->found = true;
+            incumbent->removals.assign(schedule.trail.begin() + incumbent->root, schedule.trail.end());
+            if (options.on_solution)
+                options.on_solution(schedule, schedule.cost);
+            conflict.all = true; // the next one must be cheaper, whatever the decisions
+            return false;
+        }
+        if (options.solutions == 0)
+            return true;
+        // pass it on and look for another one, unless there are enough of them:
+        // then unwind like out of budget
+        budget.solutions++;
+        if (options.on_solution)
+            options.on_solution(schedule, schedule.cost);
+        if (budget.solutions >= options.solutions) {
+            budget.exhausted = true;
+            return false;
+        }
+        conflict.all = true; // the next one must differ, whatever the decisions
+        return false;
+    }
 
-    int on_count = Domain::count(worker.domain.on);
-    int off_count = Domain::count(worker.domain.off);
+    // branch on the first undecided day of the worker
+    Domain& domain = schedule.workers[worker].domain;
+    int day = first_day(domain.on & domain.off);
 
-    // all workers domain are empty, found a solution
-    if (on_count == 0 && off_count == 0)
-        return true;
+    // Try to put the worker on duty (remove the off duty option), then off duty
+    // seeded searches pick the first value at random,
+    // optimizing ones the value that adds nothing to the cost, if any,
+    // and warm started ones the value of the previous schedule
+    bool on_first = options.seed == 0 || (hash(options.seed, worker * schedule.days() + day) & 1);
+    if (incumbent)
+        on_first = !(schedule.workers[worker].requested_off >> day & 1) && day % 7 < 5 &&
+                   schedule.on_duty[day] < schedule.min_daily_staff;
+    if (options.warm_start)
+        on_first = (*options.warm_start)[worker] >> day & 1;
+    int level = schedule.decisions.size() + 1;
+    for (bool on_duty : { on_first, !on_first }) {
+        // Every domain change made from here is recorded on the trail,
+        // so a failed assignment is rolled back by undoing the trail down to this mark
+        size_t mark = schedule.trail.size();
+        schedule.decisions.push_back(mark);
+        schedule.reason = -1;
 
-    // find an assignment available options for the worker
-    for (int i = 0; i < 7; i++) {
-        if (worker.domain.on[i] == 1) { // worker can choose to be on duty
-            // Saving worker current state. We already know that worker.domain.on[i] == 1
-            int off = worker.domain.off[i];
-
-            // Try to put the worker on duty
-            schedule.on[i].insert(worker_id);
-            worker.domain.on[i] = 0;
-            worker.domain.off[i] = 0;
-
-            // Forward check the current state of the worker still satisfies the constraints
-            if (Constraint::check(schedule, worker_id, i)) {
-                // Propagate the changes to the other workers.
-                // The propagate function will forward check the new state of the other workers
-                // And return true if their new states are still valid
-                // Therefore, we use a copy of the schedule to propagate the changes.
-                // So when propagate returns false, there will be no need to rollback the changes
-                Schedule new_schedule = schedule;
-                if(Constraint::propagate(new_schedule, worker_id, i)) {
-                    // Passed the propagation check, recursively call the function
-                    if (scheduler(new_schedule)) {
-                        schedule = new_schedule;
-                        return true;
-                    }
-                }
+        // Forward check the current state of the worker still satisfies the constraints
+        // Then propagate the changes to the other workers, and theirs in turn.
+        // The propagate function will forward check the new state of the other workers
+        // And return true if their new states are still valid
+        Levels branch = conflict.below();
+        if (Constraint::prune(schedule, worker, day, !on_duty) &&
+                Constraint::propagate(schedule)) {
+            // Passed the propagation check, recursively call the function
+            if (search(schedule, options, branch, budget, incumbent))
+                return true;
+        }
+        else if (schedule.backjump)
+            analyze(schedule, branch);
+
+        // The assignment failed: unless it did not depend on this decision,
+        // its decisions won't be tried together again
+        bool caused = branch.contains(level);
+        if (schedule.backjump && caused)
+            learn(schedule, branch);
+
+        // rollback the changes
+        schedule.undo(mark);
+        schedule.decisions.pop_back();
+        if (schedule.stats)
+            schedule.stats->backtracks++;
+
+        if (schedule.backjump) {
+            if (!caused) {
+                // the other value would fail the same way, jump back to the deepest decision that caused it
+                conflict.assign(branch);
+                if (schedule.stats)
+                    schedule.stats->backjumps++;
+                return false;
             }
+            if (!branch.all)
+                branch.size--; // the level of this decision, the deepest one
+            conflict.merge(branch);
+        }
+    }
+    return false;
+}
+
+/*------------------------------------------------------- Schedule -------------------------------------------------------*/
+
+/// change the number of weeks to schedule, between 1 and MAX_WEEKS.
+/// Every worker gets back all his options for every day.
+void Schedule::set_weeks(int n) {
+    if (n < 1 || n > MAX_WEEKS)
+        throw std::invalid_argument("weeks must be between 1 and " + std::to_string(MAX_WEEKS));
+    weeks = n;
+    trail.clear();
+    removed_at.assign(workers.size() * days() * 2, -1);
+    on_duty.assign(days(), 0);
+    weekend_duty.assign(workers.size(), 0);
+    cost = 0;
+    on.assign(days(), Bitset());
+    off.assign(days(), Bitset());
+    staff.assign(days(), workers.size());
+    senior_staff.assign(days(), seniors.count());
+    for (int i = 0; i < days(); i++) {
+        on[i].resize(workers.size());
+        off[i].resize(workers.size());
+        for (int w = 0; w < (int)workers.size(); w++) {
+            on[i].set(w);
+            off[i].set(w);
+        }
+    }
+    for (auto& worker : workers)
+        worker.domain.on = worker.domain.off = all_days();
+    recount_staff_bound();
+}
 
-            // The assignment failed, so rollback the changes
-            schedule.on[i].erase(worker_id);
-            worker.domain.on[i] = 1;
-            worker.domain.off[i] = off;
+/// add a worker (or update its level) and return its index
+int Schedule::add_worker(const std::string& id, const std::string& level) {
+    auto it = index.find(id);
+    int w = it != index.end() ? it->second : (int)workers.size();
+    if (it == index.end()) {
+        index[id] = w;
+        workers.push_back(Worker());
+        workers[w].domain.on = workers[w].domain.off = all_days();
+        worker_start.push_back(worker_start.back());
+        degree.push_back(0);
+        part_of.push_back(-1);
+        queued_rows.push_back(0);
+        queued_conflicts.push_back(0);
+        removed_at.resize(removed_at.size() + days() * 2, -1);
+        weekend_duty.push_back(0);
+        seniors.resize(workers.size());
+        for (int i = 0; i < days(); i++) {
+            on[i].resize(workers.size());
+            off[i].resize(workers.size());
+            on[i].set(w);
+            off[i].set(w);
+            staff[i]++;
+            staff_bound[i]++;
         }
+    }
+    else if (workers[w].senior) {
+        for (int i = 0; i < days(); i++)
+            senior_staff[i] -= (workers[w].domain.on >> i & 1) != 0;
+    }
+    workers[w].id = id;
+    workers[w].level = level;
+    workers[w].senior = level == "senior";
+    if (workers[w].senior) {
+        seniors.set(w);
+        for (int i = 0; i < days(); i++)
+            senior_staff[i] += (workers[w].domain.on >> i & 1) != 0;
+    }
+    else seniors.reset(w);
+    return w;
+}
 
+/// declare that the given workers cannot work together the same day. Unknown ids are ignored.
+void Schedule::add_conflict(const std::vector<std::string>& ids) {
+    std::vector<int> group;
+    for (auto& id : ids) {
+        auto it = index.find(id);
+        if (it != index.end())
+            group.push_back(it->second);
+    }
+    add_conflicts({ group });
+}
 
-        if (worker.domain.off[i] == 1) { // worker can choose to be off duty
-            // Same as above
-            int on = worker.domain.on[i];
+/// declare conflict groups of worker indices, each a clique. Indexing them is linear in the total size
+/// of the groups, so add them all at once when there are many
+void Schedule::add_conflicts(const std::vector<std::vector<int>>& groups) {
+    int n = workers.size();
+    std::vector<int> mark(n, -1);
 
-            schedule.off[i].insert(worker_id);
-            worker.domain.on[i] = 0;
-            worker.domain.off[i] = 0;
+    // each member once, and only the groups of two workers or more
+    for (int g = 0; g < (int)groups.size(); g++) {
+        size_t start = clique_members.size();
+        for (int w : groups[g]) {
+            if (mark[w] != g) {
+                mark[w] = g;
+                clique_members.push_back(w);
+            }
+        }
+        if (clique_members.size() - start < 2)
+            clique_members.resize(start);
+        else
+            clique_start.push_back(clique_members.size());
+    }
 
-            if (Constraint::check(schedule, worker_id, i)) {
-                Schedule new_schedule = schedule;
-                if(Constraint::propagate(new_schedule, worker_id, i)) {
-                    if (scheduler(new_schedule)) {
-                        schedule = new_schedule;
-                        return true;
-                    }
+    // the cliques of each worker, counted then filled in
+    worker_start.assign(n + 1, 0);
+    for (int w : clique_members)
+        worker_start[w + 1]++;
+    for (int w = 0; w < n; w++)
+        worker_start[w + 1] += worker_start[w];
+    worker_cliques.resize(clique_members.size());
+    std::vector<int> next(worker_start.begin(), worker_start.end() - 1);
+    for (int c = 0; c < clique_count(); c++)
+        for (int w : members(c))
+            worker_cliques[next[w]++] = c;
+
+    // the workers in several cliques count the members they share once
+    mark.assign(n, -1);
+    for (int w = 0; w < n; w++) {
+        IndexRange mine = cliques(w);
+        degree[w] = mine.size() == 0 ? 0 : members(*mine.begin()).size() - 1;
+        if (mine.size() < 2)
+            continue;
+        degree[w] = 0;
+        mark[w] = w;
+        for (int c : mine)
+            for (int other : members(c))
+                if (mark[other] != w) {
+                    mark[other] = w;
+                    degree[w]++;
                 }
+    }
+
+    // split the cliques in disjoint parts, the largest cliques first
+    std::vector<int> order(clique_count());
+    for (int c = 0; c < clique_count(); c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return members(a).size() > members(b).size(); });
+    parts = 0;
+    part_of.assign(n, -1);
+    for (int c : order) {
+        int left = 0;
+        for (int w : members(c))
+            left += part_of[w] == -1;
+        if (left < 2)
+            continue;
+        for (int w : members(c))
+            if (part_of[w] == -1)
+                part_of[w] = parts;
+        parts++;
+    }
+    recount_staff_bound();
+}
+
+/// return the workers the worker conflicts with, in index order
+std::vector<int> Schedule::conflicting(int worker) const {
+    std::vector<int> others;
+    for (int c : cliques(worker))
+        for (int other : members(c))
+            if (other != worker)
+                others.push_back(other);
+    std::sort(others.begin(), others.end());
+    others.erase(std::unique(others.begin(), others.end()), others.end());
+    return others;
+}
+
+/// force the worker on (or off) duty the given day, from 0. The other option is removed as a fact
+/// and remembered in the worker, see repair()
+void Schedule::pin(int worker, int day, bool on_duty) {
+    Worker& w = workers[worker];
+    (on_duty ? w.pinned_on : w.pinned_off) |= day_bit(day);
+    Domain& domain = w.domain;
+    if ((on_duty ? domain.off : domain.on) >> day & 1)
+        remove(worker, day, !on_duty);
+    clear_queue();
+}
+
+/// decide the days that are not freed as in the assignment, and propagate
+bool Schedule::fix_assignment(const std::vector<Days>& assignment, const std::vector<Days>& freed) {
+    for (int w = 0; w < (int)workers.size(); w++) {
+        Domain& domain = workers[w].domain;
+        Days fixed = all_days() & ~freed[w];
+        // remove the on duty option of the days off, and the off duty option of the days on
+        Days remove_on = fixed & ~assignment[w] & domain.on & domain.off;
+        Days remove_off = fixed & assignment[w] & domain.on & domain.off;
+        for (; remove_on; remove_on &= remove_on - 1)
+            if (!Constraint::prune(*this, w, first_day(remove_on), true))
+                return false;
+        for (; remove_off; remove_off &= remove_off - 1)
+            if (!Constraint::prune(*this, w, first_day(remove_off), false))
+                return false;
+    }
+    return Constraint::propagate(*this);
+}
+
+/// record that the worker would rather be off duty the given day, from 1. Unknown ids are ignored.
+void Schedule::add_request_off(const std::string& id, int day) {
+    if (day < 1 || day > MAX_DAYS)
+        throw std::invalid_argument("requested day off must be between 1 and " + std::to_string(MAX_DAYS));
+    auto it = index.find(id);
+    if (it != index.end())
+        workers[it->second].requested_off |= day_bit(day - 1);
+}
+
+/// recompute the staff bound of each day from the domains
+void Schedule::recount_staff_bound() {
+    part_staff.assign(days() * parts, 0);
+    staff_bound.assign(days(), 0);
+    for (int w = 0; w < (int)workers.size(); w++) {
+        int p = part_of[w];
+        for (int i = 0; i < days(); i++)
+            if ((workers[w].domain.on >> i & 1) && (p == -1 || part_staff[i * parts + p]++ == 0))
+                staff_bound[i]++;
+    }
+}
+
+/// recompute the cost counters from the domains
+void Schedule::recount_cost() {
+    on_duty.assign(days(), 0);
+    weekend_duty.assign(workers.size(), 0);
+    cost = 0;
+    for (int w = 0; w < (int)workers.size(); w++)
+        for (int i = 0; i < days(); i++)
+            if (is_on(w, i))
+                count_on_duty(w, i, 1);
+}
+
+/// update the cost counters when the worker becomes (delta 1) or stops being (delta -1) on duty for the day
+void Schedule::count_on_duty(int worker, int day, int delta) {
+    // staff beyond the minimum
+    int& staff_on_duty = on_duty[day];
+    if (delta > 0)
+        cost += excess_weight * (staff_on_duty++ >= min_daily_staff);
+    else
+        cost -= excess_weight * (--staff_on_duty >= min_daily_staff);
+
+    // saturday and sunday, adding 2k+1 to go from k^2 to (k+1)^2
+    if (day % 7 >= 5) {
+        int& k = weekend_duty[worker];
+        if (delta > 0)
+            cost += weekend_weight * (2 * k++ + 1);
+        else
+            cost -= weekend_weight * (2 * --k + 1);
+    }
+
+    if (workers[worker].requested_off >> day & 1)
+        cost += delta * request_weight;
+}
+
+/// remove the on (or off) duty option of the worker for the given day, record it on the trail
+/// and queue the constraints watching it
+void Schedule::remove(int worker, int day, bool on_duty) {
+    Domain& domain = workers[worker].domain;
+    bool undecided = (domain.on & domain.off) >> day & 1;
+    // decided on duty when the off option goes, no longer when the on option goes too
+    if (on_duty ? !(domain.off >> day & 1) : (domain.on >> day & 1))
+        count_on_duty(worker, day, on_duty ? -1 : 1);
+    if (on_duty) {
+        domain.on &= ~day_bit(day);
+        on[day].reset(worker);
+        staff[day]--;
+        senior_staff[day] -= workers[worker].senior;
+        int p = part_of[worker];
+        if (p == -1 || --part_staff[day * parts + p] == 0)
+            staff_bound[day]--;
+    } else {
+        domain.off &= ~day_bit(day);
+        off[day].reset(worker);
+    }
+    removed_at[literal(worker, day, on_duty)] = trail.size();
+    trail.push_back({ worker, day, on_duty, reason, cause });
+
+    if (on_duty) {
+        // one more day off, and one less worker for the day
+        enqueue(MAX_CONSEC_DAYS_OFF, worker, day);
+        enqueue(MIN_DAILY_STAFF, worker, day);
+    } else {
+        // one less possible day off
+        enqueue(MIN_DAYS_OFF, worker, day);
+        if (domain.on >> day & 1) // on duty
+            enqueue(CONFLICTS, worker, day);
+    }
+    if (symmetric(worker))
+        enqueue(SYMMETRY, worker, day);
+    // after the row constraints, whose explanations are finer
+    if (patterns)
+        enqueue(PATTERNS, worker, day);
+
+    // one less undecided day for the worker
+    if (undecided && !heap.position.empty()) {
+        if (domain.on & domain.off)
+            heap.update(worker, priority(worker));
+        else
+            heap.erase(worker);
+    }
+}
+
+/// queue a constraint instance unless it is already queued
+void Schedule::enqueue(ConstraintType type, int worker, int day) {
+    switch (type) {
+        case MIN_DAYS_OFF:
+        case MAX_CONSEC_DAYS_OFF:
+        case SYMMETRY:
+        case PATTERNS:
+            if (queued_rows[worker] >> type & 1)
+                return;
+            queued_rows[worker] |= 1 << type;
+            break;
+        case MIN_DAILY_STAFF:
+            if (queued_days >> day & 1)
+                return;
+            queued_days |= day_bit(day);
+            break;
+        default:
+            if (queued_conflicts[worker] >> day & 1)
+                return;
+            queued_conflicts[worker] |= day_bit(day);
+            break;
+    }
+    if (queue_tail - queue_head == queue.size())
+        reserve_queue(2 * queue.size() + 64);
+    queue[queue_tail++ % queue.size()] = { type, worker, day };
+}
+
+/// empty the propagation queue
+void Schedule::clear_queue() {
+    for (; queue_head < queue_tail; queue_head++) {
+        Propagation& p = queue[queue_head % queue.size()];
+        queued_rows[p.worker] = 0;
+        queued_conflicts[p.worker] = 0;
+    }
+    queued_days = 0;
+    queue_head = queue_tail = 0;
+}
+
+/// make room for n constraints in the propagation queue
+void Schedule::reserve_queue(size_t n) {
+    if (n <= queue.size())
+        return;
+    // unroll the queued constraints at the start of the new ring
+    std::vector<Propagation> ring(n);
+    for (size_t i = queue_head; i < queue_tail; i++)
+        ring[i - queue_head] = queue[i % queue.size()];
+    queue.swap(ring);
+    queue_tail -= queue_head;
+    queue_head = 0;
+}
+
+/// restore the domain values removed since the trail had the given size
+void Schedule::undo(size_t mark) {
+    while (trail.size() > mark) {
+        Removal& r = trail.back();
+        Domain& domain = workers[r.worker].domain;
+        if (r.on_duty ? !(domain.off >> r.day & 1) : (domain.on >> r.day & 1))
+            count_on_duty(r.worker, r.day, r.on_duty ? 1 : -1);
+        if (r.on_duty) {
+            domain.on |= day_bit(r.day);
+            on[r.day].set(r.worker);
+            staff[r.day]++;
+            senior_staff[r.day] += workers[r.worker].senior;
+            int p = part_of[r.worker];
+            if (p == -1 || part_staff[r.day * parts + p]++ == 0)
+                staff_bound[r.day]++;
+        } else {
+            domain.off |= day_bit(r.day);
+            off[r.day].set(r.worker);
+        }
+        if (((domain.on & domain.off) >> r.day & 1) && !heap.position.empty())
+            heap.update(r.worker, priority(r.worker));
+        trail.pop_back();
+    }
+    nogood_head = std::min(nogood_head, mark);
+}
+
+/// store a nogood of at most MAX_NOGOOD_SIZE literals, forgetting the older half of the store when it is full
+void Schedule::add_nogood(IndexRange literals) {
+    if (nogoods.size() >= max_nogoods) {
+        // keep the newer half and the nogoods that explain removals of the search, renumbered.
+        // Their watches are unlinked first, then linked again
+        for (Nogood& nogood : nogoods)
+            for (int k = 0; k < std::min(2, nogood.size); k++)
+                watches[nogood.literal[k]] = -1;
+        // the nogoods explaining removals are marked in their unlinked watches, then given their new index
+        size_t start = decisions.empty() ? trail.size() : decisions[0];
+        for (size_t i = start; i < trail.size(); i++)
+            if (trail[i].reason == NOGOODS)
+                nogoods[trail[i].cause].next[0] = -2;
+        size_t n = 0;
+        for (size_t g = 0; g < nogoods.size(); g++)
+            nogoods[g].next[1] = g >= nogoods.size() / 2 || nogoods[g].next[0] == -2 ? (int)n++ : -1;
+        for (size_t i = start; i < trail.size(); i++)
+            if (trail[i].reason == NOGOODS)
+                trail[i].cause = nogoods[trail[i].cause].next[1];
+        for (size_t g = 0; g < nogoods.size(); g++)
+            if (nogoods[g].next[1] != -1)
+                nogoods[nogoods[g].next[1]] = nogoods[g];
+        nogoods.resize(n);
+        for (size_t g = 0; g < n; g++)
+            for (int k = 0; k < std::min(2, nogoods[g].size); k++) {
+                nogoods[g].next[k] = watches[nogoods[g].literal[k]];
+                watches[nogoods[g].literal[k]] = g * 2 + k;
             }
+    }
+    Nogood nogood;
+    nogood.size = literals.size();
+    std::copy(literals.begin(), literals.end(), nogood.literal);
+    int g = nogoods.size();
+    for (int k = 0; k < std::min(2, nogood.size); k++) {
+        nogood.next[k] = watches[nogood.literal[k]];
+        watches[nogood.literal[k]] = g * 2 + k;
+    }
+    nogoods.push_back(nogood);
+}
+
+/// forget every nogood
+void Schedule::clear_nogoods() {
+    for (Nogood& nogood : nogoods)
+        for (int k = 0; k < std::min(2, nogood.size); k++)
+            watches[nogood.literal[k]] = -1;
+    nogoods.clear();
+}
 
-            schedule.off[i].erase(worker_id);
-            worker.domain.on[i] = on;
-            worker.domain.off[i] = 1;
+/// fill the heap with the workers that have undecided days
+void Schedule::build_heap(unsigned seed, const std::vector<int>* only) {
+    heap_seed = seed;
+    heap.clear(workers.size());
+    if (only) {
+        for (int w : *only)
+            if (workers[w].domain.on & workers[w].domain.off)
+                heap.update(w, priority(w));
+        return;
+    }
+    for (int w = 0; w < (int)workers.size(); w++)
+        if (workers[w].domain.on & workers[w].domain.off)
+            heap.update(w, priority(w));
+}
+
+/// chain the workers that can be swapped in any schedule: same level, same requests, same domain
+/// and no conflict. See symmetric_next
+void Schedule::chain_symmetries() {
+    int n = workers.size();
+    symmetric_prev.assign(n, -1);
+    symmetric_next.assign(n, -1);
+    std::vector<int> order;
+    for (int w = 0; w < n; w++)
+        if (degree[w] == 0)
+            order.push_back(w);
+    auto key = [&](int w) {
+        const Worker& worker = workers[w];
+        return std::tie(worker.level, worker.requested_off, worker.domain.on, worker.domain.off);
+    };
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return key(a) < key(b); });
+    for (size_t i = 1; i < order.size(); i++) {
+        if (key(order[i - 1]) == key(order[i])) {
+            symmetric_next[order[i - 1]] = order[i];
+            symmetric_prev[order[i]] = order[i - 1];
         }
     }
-    return false;
 }
 
-/*------------------------------------------------------- Schedule -------------------------------------------------------*/
+/// number of schedules a solved schedule stands for when the chains are set up: the distinct orders of the rows
+/// of each chain of interchangeable workers, 1 without chains. LLONG_MAX when there are more
+long long Schedule::symmetric_count() const {
+    unsigned __int128 count = 1;
+    for (int w = 0; w < (int)workers.size(); w++) {
+        if (!symmetric(w) || symmetric_prev[w] != -1)
+            continue;
+        // the rows of a chain are ordered, so the equal ones follow each other:
+        // each run of equal rows takes any of the positions among those of the runs before it and its own
+        int placed = 0;
+        for (int first = w; first != -1;) {
+            Days row = workers[first].domain.on & ~workers[first].domain.off;
+            int next = first;
+            for (int k = 1; next != -1 && (workers[next].domain.on & ~workers[next].domain.off) == row; k++) {
+                count = count * ++placed / k; // times the binomial (placed, k) over (placed - 1, k - 1), exactly
+                if (count > LLONG_MAX)
+                    return LLONG_MAX;
+                next = symmetric_next[next];
+            }
+            first = next;
+        }
+    }
+    return (long long)count;
+}
+
+/// MRV priority of the worker: fewest undecided days first, then most conflicts
+uint64_t Schedule::priority(int worker) const {
+    const Domain& domain = workers[worker].domain;
+    uint64_t undecided = Domain::count(domain.on & domain.off);
+    uint64_t conflicts = std::min<uint64_t>(degree[worker], 0xffffff);
+    uint64_t tie = (heap_seed == 0 ? worker : hash(heap_seed, worker)) & 0xffffff;
+    return undecided << 48 | (0xffffff - conflicts) << 24 | tie;
+}
+
+/// write the schedule one week at a time, each week preceded by its number when there are several
+void Schedule::write(std::ostream& out) {
+    for (int k = 0; k < weeks; k++) {
+        if (weeks > 1)
+            out << (k > 0 ? "\n" : "") << "Week " << k + 1 << "\n";
+        for (int w = 0; w < (int)workers.size(); w++) {
+            for (int i = 7 * k; i < 7 * k + 7; i++) {
+                if (is_on(w, i))
+                    out << workers[w].id << " ";
+                else if (is_off(w, i))
+                    out << "x ";
+                else
+                    out << "- ";
+            }
+            out << "\n";
+        }
+        out.flush(); // the week is complete
+    }
+}
 
 /// print the schedule
 std::string Schedule::to_string() {
-    std::string s = "";
-    for (auto& p : workers) {
-        auto& id = p.first;
-        for (int i = 0; i < 7; i++) {
-            if (on[i].count(id))
-                s += id + " ";
-            else if (off[i].count(id))
-                s += "x ";
-            else
-                s += "- ";
-        }
-        s += "\n";
+    std::ostringstream out;
+    write(out);
+    return out.str();
+}
+
+/*--------------------------------------------------------- Stats --------------------------------------------------------*/
+
+void Stats::add(const Stats& other) {
+    nodes += other.nodes;
+    backtracks += other.backtracks;
+    backjumps += other.backjumps;
+    learned += other.learned;
+    allocations += other.allocations;
+    for (int t = 0; t < CONSTRAINT_TYPES; t++) {
+        propagations[t] += other.propagations[t];
+        failures[t] += other.failures[t];
+        pruned[t] += other.pruned[t];
+        nanoseconds[t] += other.nanoseconds[t];
+    }
+}
+
+/// write the statistics as a human readable table
+void Stats::write(std::ostream& out) const {
+    char line[128];
+    out << "Nodes: " << nodes << "\n";
+    out << "Backtracks: " << backtracks << "\n";
+    out << "Backjumps: " << backjumps << "\n";
+    out << "Nogoods learned: " << learned << "\n";
+    if (allocations_counted)
+        out << "Allocations: " << allocations << "\n";
+    snprintf(line, sizeof(line), "%-20s %12s %10s %12s %10s\n", "constraint", "propagations", "failures", "pruned", "ms");
+    out << line;
+    for (int t = 0; t < CONSTRAINT_TYPES; t++) {
+        snprintf(line, sizeof(line), "%-20s %12lld %10lld %12lld %10.1f\n", CONSTRAINT_NAMES[t],
+                 propagations[t], failures[t], pruned[t], nanoseconds[t] / 1e6);
+        out << line;
     }
-    return s;
 }
 
-/// Return the number of days that the worker is on or off duty,
-/// given the schedule for on or off duty
-int Schedule::count(std::unordered_set<std::string> arr[7], std::string id) {
-    int count = 0;
-    for (int i = 0; i < 7; i++)
-        if (arr[i].count(id))
-            count++;
-    return count;
+/// write the statistics as a JSON object
+void Stats::write_json(std::ostream& out) const {
+    out << "{\"nodes\": " << nodes << ", \"backtracks\": " << backtracks
+        << ", \"backjumps\": " << backjumps << ", \"learned\": " << learned;
+    if (allocations_counted)
+        out << ", \"allocations\": " << allocations;
+    out << ", \"constraints\": {";
+    for (int t = 0; t < CONSTRAINT_TYPES; t++) {
+        out << (t ? ", " : "") << "\"" << CONSTRAINT_NAMES[t] << "\": {"
+            << "\"propagations\": " << propagations[t]
+            << ", \"failures\": " << failures[t]
+            << ", \"pruned\": " << pruned[t]
+            << ", \"ms\": " << nanoseconds[t] / 1e6 << "}";
+    }
+    out << "}}";
+}
+
+/*--------------------------------------------------------- Heap ---------------------------------------------------------*/
+
+/// reset the heap to hold no worker among n
+void Heap::clear(int n) {
+    heap.clear();
+    position.assign(n, -1);
+    key.assign(n, 0);
+}
+
+/// insert the worker or move it to match its new key
+void Heap::update(int w, uint64_t new_key) {
+    if (!contains(w)) {
+        key[w] = new_key;
+        position[w] = heap.size();
+        heap.push_back(w);
+        sift_up(position[w]);
+    }
+    else if (new_key < key[w]) {
+        key[w] = new_key;
+        sift_up(position[w]);
+    }
+    else {
+        key[w] = new_key;
+        sift_down(position[w]);
+    }
+}
+
+void Heap::erase(int w) {
+    int i = position[w];
+    swap(i, heap.size() - 1);
+    heap.pop_back();
+    position[w] = -1;
+    if (i < (int)heap.size()) {
+        sift_up(i);
+        sift_down(i);
+    }
+}
+
+void Heap::swap(int i, int j) {
+    std::swap(heap[i], heap[j]);
+    position[heap[i]] = i;
+    position[heap[j]] = j;
+}
+
+void Heap::sift_up(int i) {
+    while (i > 0 && key[heap[i]] < key[heap[(i - 1) / 2]]) {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void Heap::sift_down(int i) {
+    int n = heap.size();
+    while (true) {
+        int smallest = i;
+        for (int child = 2 * i + 1; child <= 2 * i + 2 && child < n; child++)
+            if (key[heap[child]] < key[heap[smallest]])
+                smallest = child;
+        if (smallest == i)
+            return;
+        swap(i, smallest);
+        i = smallest;
+    }
 }
 
 /*------------------------------------------------------- Constraint -------------------------------------------------------*/
 
 /// Checks if the constraints are satisfied.
-bool Constraint::check(Schedule& schedule, std::string worker_id, int day) {
-    return check_min_days_off(schedule, worker_id) &&
-              check_max_consec_days_off(schedule, worker_id) &&
-                check_min_daily_staff(schedule, worker_id, day) && // check both min daily staff and min daily senior staff
-                        check_conflicts(schedule, worker_id, day);
+bool Constraint::check(Schedule& schedule, int worker, int day) {
+    Domain& domain = schedule.workers[worker].domain;
+    return ((domain.on | domain.off) >> day & 1) && // the day still has an option
+             check_min_days_off(schedule, worker) &&
+              check_max_consec_days_off(schedule, worker) &&
+                check_min_daily_staff(schedule, worker, day) && // check both min daily staff and min daily senior staff
+                        check_conflicts(schedule, worker, day);
 }
 
-/// Propagate the constraints and forward check the other workers new states.
-bool Constraint::propagate(Schedule& schedule, std::string worker_id, int day) {
-    return propagate_min_days_off(schedule, worker_id) &&
-                propagate_max_consec_days_off(schedule, worker_id) &&
-                    propagate_min_daily_staff(schedule, worker_id, day) &&
-                            propagate_conflicts(schedule, worker_id, day);
+/// Propagate the queued constraints until no more value can be removed,
+/// forward checking the new states of the workers. The queue is empty afterwards.
+bool Constraint::propagate(Schedule& schedule) {
+    while (true) {
+        // propagating may queue more constraints, so don't keep a reference into the queue
+        Propagation p;
+        if (schedule.nogood_head < schedule.trail.size()) {
+            // the nogoods watching the next removal first
+            const Removal& r = schedule.trail[schedule.nogood_head++];
+            int literal = schedule.literal(r.worker, r.day, r.on_duty);
+            if ((size_t)literal >= schedule.watches.size() || schedule.watches[literal] == -1)
+                continue;
+            p = { NOGOODS, literal, r.day };
+        }
+        else if (schedule.queue_head < schedule.queue_tail) {
+            p = schedule.queue[schedule.queue_head++ % schedule.queue.size()];
+            // removals are stamped with the constraint making them
+            schedule.reason = p.type;
+            schedule.cause = p.worker;
+        }
+        else break;
+
+        size_t trail_size = schedule.trail.size();
+        std::chrono::steady_clock::time_point start_time;
+        if (schedule.stats)
+            start_time = std::chrono::steady_clock::now();
+
+        bool consistent;
+        switch (p.type) {
+            case MIN_DAYS_OFF:
+                schedule.queued_rows[p.worker] &= ~(1 << MIN_DAYS_OFF);
+                consistent = propagate_min_days_off(schedule, p.worker);
+                break;
+            case MAX_CONSEC_DAYS_OFF:
+                schedule.queued_rows[p.worker] &= ~(1 << MAX_CONSEC_DAYS_OFF);
+                consistent = propagate_max_consec_days_off(schedule, p.worker);
+                break;
+            case MIN_DAILY_STAFF:
+                schedule.queued_days &= ~day_bit(p.day);
+                consistent = propagate_min_daily_staff(schedule, p.worker, p.day);
+                break;
+            case CONFLICTS:
+                schedule.queued_conflicts[p.worker] &= ~day_bit(p.day);
+                consistent = propagate_conflicts(schedule, p.worker, p.day);
+                break;
+            case SYMMETRY:
+                schedule.queued_rows[p.worker] &= ~(1 << SYMMETRY);
+                consistent = propagate_symmetry(schedule, p.worker);
+                break;
+            case PATTERNS:
+                schedule.queued_rows[p.worker] &= ~(1 << PATTERNS);
+                consistent = propagate_patterns(schedule, p.worker);
+                break;
+            default:
+                consistent = propagate_nogoods(schedule, p.worker); // the literal, not a worker
+                break;
+        }
+
+        if (schedule.stats) {
+            Stats& stats = *schedule.stats;
+            stats.propagations[p.type]++;
+            stats.failures[p.type] += !consistent;
+            stats.pruned[p.type] += schedule.trail.size() - trail_size;
+            stats.nanoseconds[p.type] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_time).count();
+        }
+        if (!consistent) {
+            schedule.failure = p.type;
+            schedule.clear_queue();
+            return false;
+        }
+    }
+    schedule.queue_head = schedule.queue_tail = 0;
+    return true;
 }
 
-bool Constraint::check_min_days_off(Schedule& schedule, std::string worker_id) {
-    // The minimum days off satisfied if sum of the remaining options for the worker to be off duty (domain)
-    // and the actual off duty (schedule) days is greater than or equal to the minimum days off
-    return Domain::count(schedule.workers[worker_id].domain.off) +
-                Schedule::count(schedule.off, worker_id) >=
-                    schedule.min_days_off;
+/// Queue every constraint and propagate them.
+bool Constraint::propagate_all(Schedule& schedule) {
+    for (int w = 0; w < (int)schedule.workers.size(); w++) {
+        schedule.enqueue(MIN_DAYS_OFF, w, 0);
+        schedule.enqueue(MAX_CONSEC_DAYS_OFF, w, 0);
+        if (schedule.symmetric(w))
+            schedule.enqueue(SYMMETRY, w, 0);
+        if (schedule.patterns)
+            schedule.enqueue(PATTERNS, w, 0);
+        for (int i = 0; i < schedule.days(); i++) {
+            if (!check(schedule, w, i)) {
+                schedule.clear_queue();
+                return false;
+            }
+            if (schedule.is_on(w, i))
+                schedule.enqueue(CONFLICTS, w, i);
+        }
+    }
+    for (int i = 0; i < schedule.days(); i++)
+        schedule.enqueue(MIN_DAILY_STAFF, 0, i);
+    return propagate(schedule);
 }
 
-bool Constraint::check_max_consec_days_off(Schedule& schedule, std::string worker_id) {
-    // count the number of consecutive days that the worker is off duty
-    int count = 0;
-    for (int i = 0; i < 7; i++) {
-        if (schedule.off[i].count(worker_id) > 0) count++;
-        else count = 0;
+/// Remove a value from the worker domain and forward check his new state.
+bool Constraint::prune(Schedule& schedule, int worker, int day, bool on_duty) {
+    schedule.remove(worker, day, on_duty);
+    if (check(schedule, worker, day))
+        return true;
+    // the constraint breaking, or the one that removed the other option when the day has none left
+    schedule.failure = !check_min_days_off(schedule, worker)              ? MIN_DAYS_OFF
+                     : !check_max_consec_days_off(schedule, worker)       ? MAX_CONSEC_DAYS_OFF
+                     : !check_min_daily_staff(schedule, worker, day)      ? MIN_DAILY_STAFF
+                     : !check_conflicts(schedule, worker, day)            ? CONFLICTS
+                     : schedule.reason;
+    if (schedule.backjump)
+        explain_failure(schedule, worker, day);
+    return false;
+}
 
-        if (count >= schedule.max_consec_days_off) // exceeds the maximum consecutive days off
+bool Constraint::check_min_days_off(Schedule& schedule, int worker) {
+    // The minimum days off satisfied if the number of days the worker is or can be off duty
+    // is greater than or equal to the minimum days off, every week
+    Days off = schedule.workers[worker].domain.off;
+    for (int k = 0; k < schedule.weeks; k++)
+        if (Domain::count(week_days(off, k)) < schedule.min_days_off)
             return false;
+    return true;
+}
+
+bool Constraint::check_max_consec_days_off(Schedule& schedule, int worker) {
+    if (schedule.max_consec_days_off <= 0)
+        return false;
+
+    // days that the worker is off duty
+    Domain& domain = schedule.workers[worker].domain;
+    Days days_off = domain.off & ~domain.on;
+
+    // keep the days starting a run of max_consec_days_off days off.
+    // The days are one mask for the whole horizon, so runs across weeks count too
+    Days runs = days_off;
+    for (int i = 1; i < schedule.max_consec_days_off; i++)
+        runs &= days_off >> i;
+    return runs == 0; // otherwise exceeds the maximum consecutive days off
+}
+
+bool Constraint::check_min_daily_staff(Schedule& schedule, int, int day) {
+    // count the workers already on duty and those who still have options to be on duty,
+    // at most one of each part of the cliques
+    return schedule.staff_bound[day] >= schedule.min_daily_staff &&
+        schedule.senior_staff[day] >= schedule.min_daily_seniors;
+}
+
+bool Constraint::check_conflicts(Schedule& schedule, int worker, int day) {
+    if (schedule.is_on(worker, day)) { // current worker is on duty
+        // check if any other member of his cliques is on duty too.
+        for (int c : schedule.cliques(worker))
+            for (int other : schedule.members(c))
+                if (other != worker && schedule.is_on(other, day))
+                    return false;
     }
     return true;
 }
 
-bool Constraint::check_min_daily_staff(Schedule& schedule, std::string worker_id, int day) {
-    int workers_count = 0;
-    int seniors_count = 0;
-    for (auto& p : schedule.workers) {
-        auto& w = p.second;
-        // count the worker already in the schedule and those who still have options to be on duty
-        if (w.domain.on[day] || schedule.on[day].count(w.id) > 0) {
-            if (w.level == "senior")
-                seniors_count++;
-            workers_count++;
+bool Constraint::propagate_min_days_off(Schedule& schedule, int worker) {
+    Domain& domain = schedule.workers[worker].domain;
+    for (int k = 0; k < schedule.weeks; k++) {
+        // count the number of days of the week the worker can be or is off duty
+        if (Domain::count(week_days(domain.off, k)) == schedule.min_days_off) {
+            // This worker has already reached the minimum
+            // Therefore, for any remaining options to be off duty in his domain, he should be off duty.
+            for (int i = 7 * k; i < 7 * k + 7; i++)
+                if ((domain.on & domain.off) >> i & 1) // both options available
+                    if (prune(schedule, worker, i, true) == false) // remove the on duty option
+                        return false;
         }
     }
-    return workers_count >= schedule.min_daily_staff && 
-        seniors_count >= schedule.min_daily_seniors;
+    return true;
 }
 
-bool Constraint::check_conflicts(Schedule& schedule, std::string worker_id, int day) {
-    if (schedule.on[day].count(worker_id) > 0) { // current worker is on duty
-        // check if any other worker with whom he has conflicts is on duty too.
-        for (auto& id : schedule.conflicts[worker_id])
-            if (schedule.on[day].count(id) > 0)
-                return false;
+bool Constraint::propagate_max_consec_days_off(Schedule& schedule, int worker) {
+    // For any day the worker can still choose to be off duty,
+    // check when assigned off duty, the number of consecutive days off is still within the limit
+    // If it isn't, the worker must be on duty that day.
+    Domain& domain = schedule.workers[worker].domain;
+    for (int k = 0; k < schedule.days(); k++) {
+        if ((domain.on & domain.off) >> k & 1) { // can be off duty for the kth day
+            Days days_off = domain.off & ~domain.on;
+
+            // count the number of already off days arround the kth day
+            int i = k - 1, j = k + 1;
+            while (i >= 0 && (days_off >> i & 1))
+                i--;
+            while (j < schedule.days() && (days_off >> j & 1))
+                j++;
+
+            // So, when assigned off duty in the kth day, all [i+1, j-1] days are off.
+            if (j - i - 1 >= schedule.max_consec_days_off) // exceeds the maximum consecutive days off
+                if (prune(schedule, worker, k, false) == false) // remove the off duty option
+                    return false;
+        }
     }
     return true;
 }
 
-bool Constraint::propagate_min_days_off(Schedule& schedule, std::string worker_id) {
-    Worker& worker = schedule.workers[worker_id];
-    // count the number of days the worker can be or is off duty
-    int count = Domain::count(worker.domain.off) + 
-                Schedule::count(schedule.off, worker_id);
+bool Constraint::propagate_min_daily_staff(Schedule& schedule, int, int day) {
+    bool staff_reached = schedule.staff_bound[day] == schedule.min_daily_staff;
+    bool seniors_reached = schedule.senior_staff[day] == schedule.min_daily_seniors;
+    if (!staff_reached && !seniors_reached)
+        return true;
 
-    if (count == schedule.min_days_off) { 
-        // This worker has already reached the minimum
-        // Therefore, for any remaining options to be off duty in his domain, he should be off duty.
-        for (int i = 0; i < 7; i++) {
-            if (worker.domain.off[i] == 1) { // available off duty option
-                if (worker.domain.on[i] == 1) { // available on duty option
-                    worker.domain.on[i] = 0; // remove the on duty option
-
-                    // forward check if he can be off duty
-                    worker.domain.off[i] = 0;
-                    schedule.off[i].insert(worker.id);
-                    if (Constraint::check(schedule, worker.id, i) == false)
+    // already reached the minimum
+    // Therefore, all workers who still have the on duty option should be on duty (remove the off duty option),
+    // unless they share a part of a clique with others who can work: only one of them will
+    Bitset& on = schedule.on[day];
+    Bitset& off = schedule.off[day];
+    for (size_t i = 0; i < on.words.size(); i++) {
+        // workers with both options available
+        uint64_t undecided = on.words[i] & off.words[i];
+        if (!staff_reached)
+            undecided &= schedule.seniors.words[i];
+        for (; undecided; undecided &= undecided - 1) {
+            int w = i * 64 + __builtin_ctzll(undecided);
+            int p = schedule.part_of[w];
+            if (!(seniors_reached && schedule.workers[w].senior) &&
+                p != -1 && schedule.part_staff[day * schedule.parts + p] > 1)
+                continue;
+            if (prune(schedule, w, day, false) == false)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool Constraint::propagate_conflicts(Schedule& schedule, int worker, int day) {
+    if (schedule.is_on(worker, day)) { // current worker is on duty for the given day
+        // at most one member of each of his cliques is on duty
+        for (int c : schedule.cliques(worker)) {
+            for (int other : schedule.members(c)) {
+                if (other != worker && (schedule.workers[other].domain.on >> day & 1)) // available on duty option
+                    // remove the on duty option, because it conflicts with the current worker
+                    if (prune(schedule, other, day, true) == false)
                         return false;
-                    worker.domain.off[i] = 1;
-                    schedule.off[i].erase(worker.id);
-                }
             }
         }
     }
     return true;
 }
 
-bool Constraint::propagate_max_consec_days_off(Schedule& schedule, std::string worker_id) {
-    // Here we check that all remaining options to be off will not violate the maximum consecutive days off
-    // If it doesn't we propagate the constraint otherwise return false
-    Worker& worker = schedule.workers[worker_id];
+/// Order the days on duty of two interchangeable workers: from the first day, while they are decided the same,
+/// the first worker is on duty whenever the second one is. The other order is a swap of the same schedule.
+static bool order_rows(Schedule& schedule, int first, int second) {
+    Domain& a = schedule.workers[first].domain;
+    Domain& b = schedule.workers[second].domain;
+    for (int i = 0; i < schedule.days(); i++) {
+        // the first one can't work: neither can the second one
+        if (!(a.on >> i & 1) && (b.on >> i & 1)) {
+            schedule.cause = first;
+            if (Constraint::prune(schedule, second, i, true) == false)
+                return false;
+        }
+        // the second one works: so does the first one
+        if (!(b.off >> i & 1) && (a.off >> i & 1)) {
+            schedule.cause = second;
+            if (Constraint::prune(schedule, first, i, false) == false)
+                return false;
+        }
+        // go on with the next day only when they are decided the same
+        if (!(schedule.is_on(first, i) && schedule.is_on(second, i)) &&
+                !(schedule.is_off(first, i) && schedule.is_off(second, i)))
+            return true;
+    }
+    return true;
+}
+
+bool Constraint::propagate_symmetry(Schedule& schedule, int worker) {
+    int prev = schedule.symmetric_prev[worker], next = schedule.symmetric_next[worker];
+    return (prev == -1 || order_rows(schedule, prev, worker)) && (next == -1 || order_rows(schedule, worker, next));
+}
+
+/// Find the values of a row used by a sequence of week patterns satisfying both row constraints, the row having
+/// the given options. Returns false when there is no such sequence.
+static bool pattern_support(const Schedule& schedule, Days on, Days off, Days& on_support, Days& off_support) {
+    const WeekPatterns& table = WEEK_PATTERNS;
+    int weeks = schedule.weeks;
+    // runs of max days off are forbidden. Longer than the horizon, the limit is the same as one day more
+    int max = std::min(schedule.max_consec_days_off, schedule.days() + 1);
+    auto below = [](int n) { return n <= 0 ? (Days)0 : day_bit(n) - 1; }; // the run lengths less than n
 
-    // Use an array to record status of the worker in a week
-    // 0: unknown, 1: off duty (schedule), 2: not off duty but still have the option (domain)
-    int arr[7] = {0};
-    for (int i = 0; i < 7; i++) {
-        if (schedule.off[i].count(worker_id) > 0)
-            arr[i] = 1;
-        if (worker.domain.off[i] == 1)
-            arr[i] = 2;
+    // the patterns of each week allowed by the options and by the constraints within the week:
+    // the days decided on duty, and any of the undecided ones
+    uint8_t allowed[MAX_WEEKS][128];
+    int count[MAX_WEEKS];
+    for (int k = 0; k < weeks; k++) {
+        int must = week_days(on & ~off, k), free = week_days(on & off, k);
+        count[k] = 0;
+        for (int sub = free;; sub = (sub - 1) & free) {
+            int p = must | sub;
+            if (table.days_off[p] >= schedule.min_days_off && table.longest_off[p] < max)
+                allowed[k][count[k]++] = p;
+            if (sub == 0)
+                break;
+        }
     }
 
-    // for a given day if the worker has the off duty option,
-    // check when assigned off duty, the number of consecutive days off is still within the limit
-    for (int k = 0; k < 7; k++) {
-        if (arr[k] == 2) { // can be off duty for the kth day
-            // count the number of already off days arround the kth day  
-            int i = k -1, j = k + 1;
-            while (i >= 0 && arr[i] == 1)
-                i--;
-            while (j < 7 && arr[j] == 1)
-                j++;
-                    
-            // So, when assigned off duty in the kth day, all [i+1, j-1] days are off.
-            // if those days number already reaches the limit, then the ith and jth days should be on duty
-            int count = j - i - 1;
-            if (count + 1 >= schedule.max_consec_days_off) { // exceeds the maximum consecutive days off
-                if (i >= 0) {
-                    if (worker.domain.off[i] == 1) {
-                        worker.domain.off[i] = 0; // remove the off duty option
-
-                        // forward check if he can be on duty
-                        int on = worker.domain.on[i];
-
-                        worker.domain.on[i] = 0;
-                        schedule.on[i].insert(worker.id);
-                        if (Constraint::check(schedule, worker.id, i) == false)
-                            return false;
-                        worker.domain.on[i] = on;
-                        schedule.on[i].erase(worker.id);
-                    }
-                }
+    // the run of days off carried from week to week: the lengths reachable from the start of each week,
+    // and those from which the end of the horizon can be reached
+    Days forward[MAX_WEEKS + 1] = {}, backward[MAX_WEEKS + 1] = {};
+    forward[0] = 1;
+    for (int k = 0; k < weeks; k++)
+        for (int j = 0; j < count[k]; j++) {
+            int p = allowed[k][j];
+            forward[k + 1] |= p == 0 ? (forward[k] << 7) & below(max)
+                                     : (forward[k] & below(max - table.leading_off[p]) ? day_bit(table.trailing_off[p]) : 0);
+        }
+    backward[weeks] = below(max);
+    for (int k = weeks - 1; k >= 0; k--)
+        for (int j = 0; j < count[k]; j++) {
+            int p = allowed[k][j];
+            backward[k] |= p == 0 ? (backward[k + 1] >> 7) & below(max)
+                                  : (backward[k + 1] >> table.trailing_off[p] & 1 ? below(max - table.leading_off[p]) : 0);
+        }
+    if (!(forward[weeks] & backward[weeks]))
+        return false;
 
-                if (j < 7) {
-                    if (worker.domain.off[j] == 1) {
-                        worker.domain.off[j] = 0; // remove the off duty option
-
-                        int tmp = worker.domain.on[j];
-                        worker.domain.on[j] = 0;
-                        schedule.on[j].insert(worker.id);
-                        if (Constraint::check(schedule, worker.id, j) == false)
-                            return false;
-                        worker.domain.on[j] = tmp;
-                        schedule.on[j].erase(worker.id);
-                    }
-                }
+    // the values used by a pattern on such a sequence
+    on_support = off_support = 0;
+    for (int k = 0; k < weeks; k++) {
+        for (int j = 0; j < count[k]; j++) {
+            int p = allowed[k][j];
+            bool supported = p == 0 ? ((forward[k] << 7) & backward[k + 1] & below(max)) != 0
+                                    : (forward[k] & below(max - table.leading_off[p])) &&
+                                      (backward[k + 1] >> table.trailing_off[p] & 1);
+            if (supported) {
+                on_support |= (Days)p << (7 * k);
+                off_support |= (Days)(~p & 0x7f) << (7 * k);
             }
         }
     }
     return true;
 }
 
-bool Constraint::propagate_min_daily_staff(Schedule& schedule, std::string worker_id, int day) {
-    int workers_count = 0;
-    int seniors_count = 0;
-    for (auto& p : schedule.workers) {
-        auto& w = p.second;
-        // count the worker already in the schedule and those who still have options to be on duty
-        if (w.domain.on[day] || schedule.on[day].count(w.id) > 0) {
-            if (w.level == "senior")
-                seniors_count++;
-            workers_count++;
+/// Append the removals of the worker's row made before the given trail index that are enough for the pattern
+/// propagation to remove the on (or off) duty option of the day, or to fail when day is -1:
+/// those of the fewest weeks around it.
+static void explain_patterns(Schedule& schedule, int worker, int day, bool on_duty, size_t before,
+                             std::vector<int>& out) {
+    // the options of the row at the time
+    Days on = schedule.all_days(), off = schedule.all_days();
+    for (int i = 0; i < schedule.days(); i++) {
+        int l = schedule.literal(worker, i, true);
+        if (schedule.removed(l) && schedule.removed_at[l] < (int)before)
+            on &= ~day_bit(i);
+        l = schedule.literal(worker, i, false);
+        if (schedule.removed(l) && schedule.removed_at[l] < (int)before)
+            off &= ~day_bit(i);
+    }
+    // widen a window of weeks, every option outside of it given back, until the propagation still follows
+    int first = 0, last = schedule.weeks - 1;
+    for (int radius = 0; radius < schedule.weeks; radius++) {
+        bool found = false;
+        for (int center = 0; center < schedule.weeks && !found; center++) {
+            if (day != -1 && center != day / 7)
+                continue;
+            first = std::max(0, center - radius);
+            last = std::min(schedule.weeks - 1, center + radius);
+            Days window = day_bit(7 * (last + 1)) - day_bit(7 * first);
+            Days on_support, off_support;
+            bool feasible = pattern_support(schedule, on | ~window, off | ~window, on_support, off_support);
+            found = day == -1 ? !feasible
+                              : !feasible || !((on_duty ? on_support : off_support) >> day & 1);
         }
+        if (found)
+            break;
     }
+    for (int i = 7 * first; i < 7 * (last + 1); i++)
+        for (bool value : { true, false }) {
+            int l = schedule.literal(worker, i, value);
+            if (schedule.removed(l) && schedule.removed_at[l] < (int)before)
+                out.push_back(schedule.removed_at[l]);
+        }
+}
 
-    if (workers_count == schedule.min_daily_staff) { // already reached the minimum
-        // Therefore, all workers who still have the on duty option should be on duty (remove the off duty option)
-        for (auto& p : schedule.workers) {
-            if (p.second.domain.on[day] == 1) { // available on duty option
-                if (p.second.domain.off[day] == 1) { // available off duty option
-                    p.second.domain.off[day] = 0; // remove the off duty option
+bool Constraint::propagate_patterns(Schedule& schedule, int worker) {
+    Domain& domain = schedule.workers[worker].domain;
+    if (!(domain.on & domain.off))
+        return true; // decided, check() has seen it all
 
-                    // forward check if he can be on duty
-                    p.second.domain.on[day] = 0;
-                    schedule.on[day].insert(p.first);
-                    if (Constraint::check(schedule, p.first, day) == false)
-                        return false;
-                    p.second.domain.on[day] = 1;
-                    schedule.on[day].erase(p.first);
-                }
-            }
+    Days on_support, off_support;
+    if (!pattern_support(schedule, domain.on, domain.off, on_support, off_support)) {
+        // no sequence of patterns fits the row
+        if (schedule.backjump) {
+            schedule.conflict.clear();
+            explain_patterns(schedule, worker, -1, false, schedule.trail.size(), schedule.conflict);
         }
+        return false;
     }
-    // use else because if the minimum daily staff is already reached, 
-    // remaining seniors will automatically be on duty
-    else if (seniors_count == schedule.min_daily_seniors) {
-        // Same as above, but for seniors
-        for (auto& p : schedule.workers) {
-            if (p.second.level == "senior" && p.second.domain.on[day] == 1) {
-                if (p.second.domain.off[day] == 1) {
-                    p.second.domain.off[day] = 0;
+    for (Days remove_on = domain.on & ~on_support; remove_on; remove_on &= remove_on - 1)
+        if (prune(schedule, worker, first_day(remove_on), true) == false)
+            return false;
+    for (Days remove_off = domain.off & ~off_support; remove_off; remove_off &= remove_off - 1)
+        if (prune(schedule, worker, first_day(remove_off), false) == false)
+            return false;
+    return true;
+}
 
-                    p.second.domain.on[day] = 0;
-                    schedule.on[day].insert(p.first);
-                    if (Constraint::check(schedule, p.first, day) == false)
-                        return false;
-                    p.second.domain.on[day] = 1;
-                    schedule.on[day].erase(p.first);
-                }
+bool Constraint::propagate_nogoods(Schedule& schedule, int literal) {
+    // the watches of the literal, unlinked from the list when moved to another literal
+    for (int* link = &schedule.watches[literal]; *link != -1;) {
+        int g = *link / 2, k = *link % 2;
+        Nogood& nogood = schedule.nogoods[g];
+        if (nogood.size > 1) {
+            // watch a literal that does not hold yet instead
+            int j = 2;
+            while (j < nogood.size && schedule.removed(nogood.literal[j]))
+                j++;
+            if (j < nogood.size) {
+                int watch = *link;
+                *link = nogood.next[k];
+                std::swap(nogood.literal[k], nogood.literal[j]);
+                nogood.next[k] = schedule.watches[nogood.literal[k]];
+                schedule.watches[nogood.literal[k]] = watch;
+                continue;
             }
         }
+        link = &nogood.next[k];
+
+        // every other literal holds, so the other watched one must not
+        int first = nogood.literal[nogood.size > 1 ? 1 - k : 0];
+        if (nogood.size == 1 || schedule.removed(first)) {
+            schedule.conflict.clear();
+            for (int j = 0; j < nogood.size; j++)
+                schedule.conflict.push_back(schedule.removed_at[nogood.literal[j]]);
+            return false;
+        }
+        int worker = first / 2 / schedule.days(), day = first / 2 % schedule.days();
+        bool on_duty = first & 1;
+        if (!schedule.removed(schedule.literal(worker, day, !on_duty))) {
+            // keep the value by removing the other one
+            schedule.reason = NOGOODS;
+            schedule.cause = g;
+            if (prune(schedule, worker, day, !on_duty) == false)
+                return false;
+        }
     }
     return true;
 }
 
-bool Constraint::propagate_conflicts(Schedule& schedule, std::string worker_id, int day) {
-    if (schedule.on[day].count(worker_id)) { // current worker is on duty for the given day
-        for (auto& id : schedule.conflicts[worker_id]) {
-            auto& w = schedule.workers[id];
-            if (w.domain.on[day] == 1) { // available on duty option
-                w.domain.on[day] = 0; // remove the on duty option, because it conflicts with the current worker
-            
-                // check conflicts for all days
-                // the other days changes will be rolled back in the end, but the current day will be changed
-                // on[7] and off[7] will save the current status
-                int on[7] = {0};
-                int off[7] = {0};
-                for (int i = 0; i < 7; i++) {
-                    on[i] = w.domain.on[i];
-                    off[i] = w.domain.off[i];
-
-                    if (schedule.on[i].count(worker_id)) { // current worker is on duty for the ith day
-                        // set the conflict worker to off duty
-                        w.domain.on[i] = 0;
-                        w.domain.off[i] = 0;
-                        schedule.off[i].insert(w.id);
-                    }
-                }
+/// append the trail indices of the removals of the on (or off) duty options of the workers
+/// (or only the seniors) for the given day, made before the given trail index
+static void explain_day(Schedule& schedule, int day, bool on_duty, bool seniors_only, size_t before,
+                        std::vector<int>& out) {
+    Bitset& options = on_duty ? schedule.on[day] : schedule.off[day];
+    for (size_t i = 0; i < options.words.size(); i++) {
+        uint64_t removed = ~options.words[i];
+        if (seniors_only)
+            removed &= schedule.seniors.words[i];
+        for (; removed; removed &= removed - 1) {
+            int w = i * 64 + __builtin_ctzll(removed);
+            if (w >= (int)schedule.workers.size())
+                break;
+            int index = schedule.removed_at[schedule.literal(w, day, on_duty)];
+            if (index < (int)before)
+                out.push_back(index);
+        }
+    }
+}
 
-                // forward checking
-                if (Constraint::check(schedule, w.id, day) == false)
-                    return false;
-                
-                // roll back the changes
-                for (int i = 0; i < 7; i++) {
-                    if (schedule.on[i].count(worker_id)) {
-                        w.domain.on[i] = on[i];
-                        w.domain.off[i] = off[i];
-                        schedule.off[i].erase(w.id);
+/// append the trail indices of the off duty removals of the worker in the kth week
+static void explain_week(Schedule& schedule, int worker, int week, size_t before, std::vector<int>& out) {
+    for (int i = 7 * week; i < 7 * week + 7; i++) {
+        int l = schedule.literal(worker, i, false);
+        if (schedule.removed(l) && schedule.removed_at[l] < (int)before)
+            out.push_back(schedule.removed_at[l]);
+    }
+}
+
+/// Append the trail indices of the earlier removals that caused the removal at the given index.
+/// The removals before it are exactly the state the constraint saw when making it.
+void Constraint::explain(Schedule& schedule, size_t index, std::vector<int>& out) {
+    const Removal r = schedule.trail[index];
+    switch (r.reason) {
+        case MIN_DAYS_OFF:
+            // the other off duty options of the week were removed
+            explain_week(schedule, r.worker, r.day / 7, index, out);
+            break;
+        case MAX_CONSEC_DAYS_OFF:
+            // the days around are off duty
+            for (int k = r.day - 1; k >= 0; k--) {
+                int l = schedule.literal(r.worker, k, true);
+                if (!schedule.removed(l) || schedule.removed_at[l] >= (int)index)
+                    break;
+                out.push_back(schedule.removed_at[l]);
+            }
+            for (int k = r.day + 1; k < schedule.days(); k++) {
+                int l = schedule.literal(r.worker, k, true);
+                if (!schedule.removed(l) || schedule.removed_at[l] >= (int)index)
+                    break;
+                out.push_back(schedule.removed_at[l]);
+            }
+            break;
+        case MIN_DAILY_STAFF: {
+            // the others can't work that day: all the seniors left reach the minimum, or else all the workers left
+            // (the staff bound follows from the on duty options of the day alone)
+            size_t start = out.size();
+            explain_day(schedule, r.day, true, true, index, out);
+            int seniors = schedule.seniors.count() - (out.size() - start);
+            if (!schedule.workers[r.worker].senior || seniors > schedule.min_daily_seniors) {
+                out.resize(start);
+                explain_day(schedule, r.day, true, false, index, out);
+            }
+            break;
+        }
+        case CONFLICTS:
+            // the conflicting worker is on duty
+            out.push_back(schedule.removed_at[schedule.literal(r.cause, r.day, false)]);
+            break;
+        case PATTERNS:
+            // the rest of the row, in the weeks around the day
+            explain_patterns(schedule, r.worker, r.day, r.on_duty, index, out);
+            break;
+        case SYMMETRY:
+            // the days of both workers up to this one are decided the same, and the other worker's value
+            for (int w : { r.worker, r.cause })
+                for (int k = 0; k <= r.day; k++)
+                    for (bool on_duty : { true, false }) {
+                        int l = schedule.literal(w, k, on_duty);
+                        if (schedule.removed(l) && schedule.removed_at[l] < (int)index)
+                            out.push_back(schedule.removed_at[l]);
                     }
+            break;
+        case NOGOODS:
+            // the other literals of the nogood hold
+            for (int j = 0; j < schedule.nogoods[r.cause].size; j++) {
+                int l = schedule.nogoods[r.cause].literal[j];
+                if (l != schedule.literal(r.worker, r.day, !r.on_duty))
+                    out.push_back(schedule.removed_at[l]);
+            }
+            break;
+    }
+}
+
+/// Fill schedule.conflict with the removals that made check() fail for the worker and day.
+void Constraint::explain_failure(Schedule& schedule, int worker, int day) {
+    std::vector<int>& out = schedule.conflict;
+    size_t end = schedule.trail.size();
+    out.clear();
+
+    Domain& domain = schedule.workers[worker].domain;
+    if (!((domain.on | domain.off) >> day & 1)) { // no option left for the day
+        out.push_back(schedule.removed_at[schedule.literal(worker, day, true)]);
+        out.push_back(schedule.removed_at[schedule.literal(worker, day, false)]);
+        return;
+    }
+    for (int k = 0; k < schedule.weeks; k++) {
+        if (Domain::count(week_days(domain.off, k)) < schedule.min_days_off) {
+            explain_week(schedule, worker, k, end, out);
+            return;
+        }
+    }
+    if (schedule.max_consec_days_off <= 0)
+        return;
+    Days days_off = domain.off & ~domain.on;
+    Days runs = days_off;
+    for (int i = 1; i < schedule.max_consec_days_off; i++)
+        runs &= days_off >> i;
+    if (runs) {
+        int start = first_day(runs);
+        for (int i = start; i < start + schedule.max_consec_days_off; i++)
+            out.push_back(schedule.removed_at[schedule.literal(worker, i, true)]);
+        return;
+    }
+    if (schedule.staff_bound[day] < schedule.min_daily_staff) {
+        explain_day(schedule, day, true, false, end, out);
+        return;
+    }
+    if (schedule.senior_staff[day] < schedule.min_daily_seniors) {
+        explain_day(schedule, day, true, true, end, out);
+        return;
+    }
+    if (schedule.is_on(worker, day)) {
+        for (int c : schedule.cliques(worker)) {
+            for (int other : schedule.members(c)) {
+                if (other != worker && schedule.is_on(other, day)) {
+                    out.push_back(schedule.removed_at[schedule.literal(worker, day, false)]);
+                    out.push_back(schedule.removed_at[schedule.literal(other, day, false)]);
+                    return;
                 }
             }
         }
     }
-    return true;
 }
 
 /*---------------------------------------------------------------------------------------------------------------------*/
 
+/// A file mapped in memory, read only.
+/// Files that can't be mapped, like pipes, are read into a buffer instead.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string buffer;
+
+    MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::runtime_error("cannot open " + filename);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data = (const char*)p;
+                size = st.st_size;
+                mapped = true;
+            }
+        }
+        if (!mapped) {
+            char chunk[65536];
+            ssize_t n;
+            while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+                buffer.append(chunk, n);
+            data = buffer.data();
+            size = buffer.size();
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (mapped)
+            munmap((void*)data, size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+/// The whitespace separated tokens of a line, viewed in place
+struct Tokens {
+    std::string_view line;
+
+    /// return the next token, empty at the end of the line
+    std::string_view next() {
+        size_t start = 0;
+        while (start < line.size() && isspace((unsigned char)line[start]))
+            start++;
+        size_t end = start;
+        while (end < line.size() && !isspace((unsigned char)line[end]))
+            end++;
+        std::string_view token = line.substr(start, end - start);
+        line.remove_prefix(end);
+        return token;
+    }
+};
+
+/// parse the whole token as an int
+static bool parse_int(std::string_view token, int& value) {
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return !token.empty() && result.ec == std::errc() && result.ptr == token.data() + token.size();
+}
+
 /// Reads the input file and creates the schedule.
+/// The file is memory mapped and parsed in a single pass. Errors throw a std::runtime_error with the line number.
 /// file format:
 ///               worker_id level
 ///               worker_id level
@@ -388,51 +1782,122 @@ bool Constraint::propagate_conflicts(Schedule& schedule, std::string worker_id,
 ///               -constraint-name value1 value2 ...
 ///               ...
 ///
-/// The constraints are: 
+/// The constraints are:
 ///                 -conflict worker_id1 worker_id2 ...
 ///                 -min-days-off value
 ///                 -max-consec-days-off value
 ///                 -min-daily-staff value
 ///                 -min-daily-seniors value
+///                 -weeks value
+///                 -request-off worker_id day1 day2 ...
+///                 -weight-requests value
+///                 -weight-weekends value
+///                 -weight-excess value
 Schedule load_file(std::string filename) {
+    MappedFile file(filename);
+    std::string_view text(file.data, file.size);
     Schedule schedule;
-    std::ifstream in(filename);
-    std::string line;
-    while (std::getline(in, line)) {
-        std::stringstream ss(line);
-        std::string s;
-        ss >> s;
+
+    // ids are interned as symbols, in order of first appearance. A symbol becomes a worker on its own line,
+    // so conflicts and requests are added once every worker is known
+    std::unordered_map<std::string_view, int> symbols;
+    std::vector<int> worker_of; // symbol -> worker index, -1 while not declared
+    auto intern = [&](std::string_view id) {
+        auto it = symbols.emplace(id, (int)symbols.size()).first;
+        if (it->second == (int)worker_of.size())
+            worker_of.push_back(-1);
+        return it->second;
+    };
+    std::vector<int> conflict_symbols;  // the groups one after the other
+    std::vector<size_t> conflict_ends;  // end of each group in conflict_symbols
+    std::vector<std::pair<int, int>> requests; // symbol, day
+
+    int line_number = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = std::min(text.find('\n', pos), text.size());
+        Tokens tokens { text.substr(pos, end - pos) };
+        pos = end + 1;
+        line_number++;
+
+        auto error = [&](const std::string& message) {
+            return std::runtime_error(filename + ":" + std::to_string(line_number) + ": " + message);
+        };
+        // read the single value of a constraint
+        auto value = [&](std::string_view name) {
+            int v;
+            if (!parse_int(tokens.next(), v))
+                throw error("expected a number after " + std::string(name));
+            if (!tokens.next().empty())
+                throw error("expected a single value after " + std::string(name));
+            return v;
+        };
+
+        std::string_view s = tokens.next();
         if (s.empty()) continue;
 
         if (s[0] == '-') {
             // constraint
             if (s == "-min-days-off") {
-                ss >> schedule.min_days_off;
+                schedule.min_days_off = value(s);
             } else if (s == "-max-consec-days-off") {
-                ss >> schedule.max_consec_days_off;
+                schedule.max_consec_days_off = value(s);
             } else if (s == "-min-daily-staff") {
-                ss >> schedule.min_daily_staff;
+                schedule.min_daily_staff = value(s);
             } else if (s == "-min-daily-seniors") {
-                ss >>schedule. min_daily_seniors;
+                schedule.min_daily_seniors = value(s);
+            }
+            else if (s == "-weeks") {
+                try {
+                    schedule.set_weeks(value(s));
+                }
+                catch (const std::invalid_argument& e) {
+                    throw error(e.what());
+                }
             }
             else if (s == "-conflict") {
-                std::vector<std::string> ids;
-                while (ss >> s)
-                    ids.push_back(s);
-                
-                for (auto& id : ids) {
-                    schedule.conflicts[id].insert(ids.begin(), ids.end());
-                    schedule.conflicts[id].erase(id);
+                for (std::string_view id = tokens.next(); !id.empty(); id = tokens.next())
+                    conflict_symbols.push_back(intern(id));
+                conflict_ends.push_back(conflict_symbols.size());
+            }
+            else if (s == "-request-off") {
+                std::string_view id = tokens.next();
+                if (id.empty())
+                    throw error("expected a worker id after -request-off");
+                int symbol = intern(id), day;
+                for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next()) {
+                    if (!parse_int(token, day) || day < 1 || day > MAX_DAYS)
+                        throw error("expected days between 1 and " + std::to_string(MAX_DAYS) + " after -request-off");
+                    requests.push_back({ symbol, day });
                 }
             }
-        } 
+            else if (s == "-weight-requests") {
+                schedule.request_weight = value(s);
+            } else if (s == "-weight-weekends") {
+                schedule.weekend_weight = value(s);
+            } else if (s == "-weight-excess") {
+                schedule.excess_weight = value(s);
+            }
+            else
+                throw error("unknown constraint " + std::string(s));
+        }
         else {
             // worker
-            Worker worker;
-            worker.id = s;
-            ss >> worker.level;
-            schedule.workers[s] = worker;
+            std::string_view level = tokens.next();
+            if (level.empty() || !tokens.next().empty())
+                throw error("expected a worker id and a level");
+            worker_of[intern(s)] = schedule.add_worker(std::string(s), std::string(level));
         }
     }
+
+    // each group becomes a clique of its declared workers, indexed once
+    std::vector<std::vector<int>> groups(conflict_ends.size());
+    for (size_t g = 0, start = 0; g < conflict_ends.size(); start = conflict_ends[g++])
+        for (size_t i = start; i < conflict_ends[g]; i++)
+            if (worker_of[conflict_symbols[i]] != -1)
+                groups[g].push_back(worker_of[conflict_symbols[i]]);
+    schedule.add_conflicts(groups);
+    for (auto& request : requests)
+        if (worker_of[request.first] != -1)
+            schedule.workers[worker_of[request.first]].requested_off |= day_bit(request.second - 1);
     return schedule;
-}
\ No newline at end of file
+}
@@ -9,74 +9,424 @@
 #include <sstream>
 #include <algorithm>
 #include <stack>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <climits>
+
+/// Set of workers, one bit per worker index.
+struct Bitset {
+    std::vector<uint64_t> words;
+
+    void resize(int n)        { words.resize((n + 63) / 64, 0); }
+    bool test(int i)    const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(int i)           { words[i >> 6] |= uint64_t(1) << (i & 63); }
+    void reset(int i)         { words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+    /// return the number of workers in the set
+    int count() const {
+        int n = 0;
+        for (uint64_t w : words) n += __builtin_popcountll(w);
+        return n;
+    }
+    /// return the number of workers in both sets
+    int count_and(const Bitset& other) const {
+        int n = 0;
+        for (size_t i = 0; i < words.size(); i++) n += __builtin_popcountll(words[i] & other.words[i]);
+        return n;
+    }
+};
+
+/// Contiguous run of indices, viewed in place
+struct IndexRange {
+    const int* first;
+    const int* last;
+
+    const int* begin() const { return first; }
+    const int* end()   const { return last; }
+    int size()         const { return last - first; }
+};
+
+/// Set of days of the schedule horizon, bit i for the ith day.
+typedef unsigned __int128 Days;
+
+const int MAX_WEEKS = 18;            // longest horizon that fits in Days
+const int MAX_DAYS  = 7 * MAX_WEEKS;
+
+inline Days day_bit(int day) { return (Days)1 << day; }
+/// return the first day of a non-empty set
+inline int first_day(Days days) {
+    uint64_t low = (uint64_t)days;
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(days >> 64));
+}
+/// return the 7 days of the kth week, as the low bits of the result
+inline int week_days(Days days, int week) { return (int)(days >> (7 * week)) & 0x7f; }
 
 /// Domain represents the set of possible values for a variable.
 /// Here it represents the possible days the worker can choose to work or not work.
 struct Domain {
-    // each array represents the 7 days of the week. 
-    // array[i] == 1 means the day is available.
-    int off[7] = { 1, 1, 1, 1, 1, 1, 1 };
-    int  on[7] = { 1, 1, 1, 1, 1, 1, 1 };
+    // each mask represents the days of the horizon.
+    // bit i set means the value is still available for the ith day.
+    // a day with only one bit left among on and off is decided.
+    Days off = 0;
+    Days  on = 0;
 
     /// return the number of possible values
-    static int count(int arr[7]) { return std::count(arr, arr + 7, 1); }
+    static int count(Days mask) {
+        return __builtin_popcountll((uint64_t)mask) + __builtin_popcountll((uint64_t)(mask >> 64));
+    }
 };
 
 /// Worker represents a variable in the CSP.
 struct Worker {
     std::string id, level;
+    bool senior = false;
     Domain domain;
+    Days requested_off = 0; // days he would rather not work, see Schedule::cost
+    Days pinned_on = 0, pinned_off = 0; // days he must work, or not, see Schedule::pin
+};
+
+/// Indexed binary min-heap of workers, ordered by a priority key stored per worker.
+struct Heap {
+    std::vector<int> heap;          // workers in heap order
+    std::vector<int> position;      // worker -> position in heap, -1 when not in the heap
+    std::vector<uint64_t> key;      // worker -> priority, the smallest key is on top
+
+    bool contains(int w) const { return position[w] != -1; }
+    int top()            const { return heap.empty() ? -1 : heap[0]; }
+
+    /// reset the heap to hold no worker among n
+    void clear(int n);
+    /// insert the worker or move it to match its new key
+    void update(int w, uint64_t new_key);
+    void erase(int w);
+
+private:
+    void swap(int i, int j);
+    void sift_up(int i);
+    void sift_down(int i);
+};
+
+/// A value removed from a worker domain, recorded so that it can be restored when backtracking.
+struct Removal {
+    int worker, day;
+    bool on_duty;
+    int reason = -1; // ConstraintType that removed the value, -1 for a search decision
+    int cause  = -1; // worker watched by that constraint, or index of the nogood
+};
+
+/// The kinds of constraints. Each instance watches a worker (MIN_DAYS_OFF, MAX_CONSEC_DAYS_OFF),
+/// a day (MIN_DAILY_STAFF, which also covers the seniors) or a worker on a day (CONFLICTS).
+/// SYMMETRY watches a worker and orders his row against the interchangeable workers next to him.
+/// PATTERNS watches a worker and replaces both row constraints when the search uses week patterns.
+/// NOGOODS are learned by the search, they watch the removals on the trail instead of being queued.
+enum ConstraintType { MIN_DAYS_OFF, MAX_CONSEC_DAYS_OFF, MIN_DAILY_STAFF, CONFLICTS, SYMMETRY, PATTERNS, NOGOODS };
+
+const int CONSTRAINT_TYPES = 7;
+/// name of each constraint type, as used in the statistics
+extern const char* const CONSTRAINT_NAMES[CONSTRAINT_TYPES];
+
+const int MAX_NOGOOD_SIZE = 8; // longer nogoods are not worth watching
+
+/// A learned nogood, stored in a fixed slot so that learning allocates nothing.
+/// Its first two literals are watched, each linked in the list of the nogoods watching it, see Schedule::watches
+struct Nogood {
+    int size = 0;
+    int literal[MAX_NOGOOD_SIZE];
+    int next[2];  // next watch in the list of literal 0 (or 1), -1 at the end
+};
+
+/// A constraint instance waiting in the propagation queue.
+struct Propagation {
+    ConstraintType type;
+    int worker, day;
+};
+
+/// Heap allocations made by the calling thread. The library doesn't count them: a program built with
+/// COUNT_ALLOCATIONS defined replaces operator new to do so, as main.cpp does. See Stats::allocations
+extern thread_local long long heap_allocations;
+/// Whether heap_allocations is counted, set by the program that counts them. Otherwise the statistics leave it out
+extern bool allocations_counted;
 
-    // static bool set_on_duty(Schedule& schedule, std::string worker_id, int day);
-    // static bool set_off_duty(Schedule& schedule, std::string worker_id, int day);
+/// Search statistics
+struct Stats {
+    long long nodes       = 0; // search nodes visited
+    long long backtracks  = 0; // assignments undone because they failed
+    long long backjumps   = 0; // failures that skipped the other value, not depending on the assignment
+    long long learned     = 0; // nogoods added to the store
+    long long allocations = 0; // heap allocations made while searching, once set up (see heap_allocations)
+
+    // per constraint type
+    long long propagations[CONSTRAINT_TYPES] = {}; // calls of the propagate_ function
+    long long failures[CONSTRAINT_TYPES]     = {}; // calls that found the schedule inconsistent
+    long long pruned[CONSTRAINT_TYPES]       = {}; // domain values removed
+    long long nanoseconds[CONSTRAINT_TYPES]  = {}; // time spent propagating
+
+    void add(const Stats& other);
+    /// write the statistics as a human readable table
+    void write(std::ostream& out) const;
+    /// write the statistics as a JSON object
+    void write_json(std::ostream& out) const;
 };
 
 /// Schedule representation
 struct Schedule {
-    // each array represents the 7 days of the week.
-    // each element of the array is a set of workers
-    // that work on that day (on[7]) or not (off[7])
-    std::unordered_set<std::string> off[7]                                     = {};
-    std::unordered_set<std::string> on[7]                                      = {};
-    std::unordered_map<std::string, Worker> workers                            = {};
-    std::unordered_map<std::string, std::unordered_set<std::string>> conflicts = {};
-    
+    // each vector has one element per day of the horizon.
+    // each element of the vector is the set of workers (by index)
+    // that can still work on that day (on) or not (off).
+    // Once solved, they are exactly the workers on and off duty.
+    std::vector<Bitset> off                   = std::vector<Bitset>(7);
+    std::vector<Bitset> on                    = std::vector<Bitset>(7);
+    Bitset seniors                            = {};
+    // number of workers, and of seniors, that can still work on each day
+    std::vector<int> staff                    = std::vector<int>(7);
+    std::vector<int> senior_staff             = std::vector<int>(7);
+    std::vector<Worker> workers               = {};
+    std::unordered_map<std::string, int> index = {}; // worker id -> worker index
+    // conflicts, as cliques of workers of which at most one can be on duty each day, in compressed rows.
+    // See add_conflicts()
+    std::vector<int> clique_members           = {};  // members of every clique, one clique after the other
+    std::vector<int> clique_start             = { 0 }; // clique -> start of its members, then the end
+    std::vector<int> worker_cliques           = {};  // cliques of every worker, one worker after the other
+    std::vector<int> worker_start             = { 0 }; // worker -> start of his cliques, then the end
+    std::vector<int> degree                   = {};  // worker -> number of workers he conflicts with
+    // disjoint parts of the cliques, each adding at most one worker to the staff of a day
+    int parts                                 = 0;
+    std::vector<int> part_of                  = {};  // worker -> part, -1 when in none
+    std::vector<int> part_staff               = {};  // day * parts + part -> members that can still work
+    std::vector<int> staff_bound              = std::vector<int>(7); // day -> most workers that can work together
+    std::vector<Removal> trail                = {}; // domain changes since the search started
+    Heap heap                                 = {}; // workers with undecided days, for MRV
+    unsigned heap_seed                        = 0;  // 0 breaks heap ties by worker index, otherwise at random
+
+    // propagation queue, filled by remove() with the constraints watching the removed value.
+    // A ring: a constraint instance is queued once at most, so it only grows past the room reserved for them all
+    std::vector<Propagation> queue            = {};
+    size_t queue_head                         = 0; // constraints taken from the queue so far
+    size_t queue_tail                         = 0; // constraints put in the queue so far
+    std::vector<uint8_t> queued_rows          = {}; // worker -> bit per queued constraint watching his whole row
+    std::vector<Days> queued_conflicts        = {}; // worker -> days with queued CONFLICTS
+    Days queued_days                          = 0;  // days with queued MIN_DAILY_STAFF
+
+    Stats* stats                              = nullptr; // statistics of the running search, when collected
+    bool patterns                             = false;   // propagate the rows over week patterns, see PATTERNS
+
+    // conflict directed backjumping, set up by scheduler().
+    // A literal is a value removal, see literal(). A nogood is a set of literals that cannot all hold.
+    bool backjump                             = false; // explain the failures in conflict
+    int failure                               = -1;    // ConstraintType of the last failure of prune() or propagate()
+    int reason = -1, cause = -1;                       // stamped on the removals, see Removal
+    std::vector<size_t> decisions             = {}; // search level - 1 -> trail index of its decision
+    std::vector<int> removed_at               = {}; // literal -> trail index of the removal, while removed
+    std::vector<int> conflict                 = {}; // trail indices of the removals that caused the last failure
+    std::vector<Nogood> nogoods               = {}; // the store, in learning order
+    std::vector<int> watches                  = {}; // literal -> first watch of a nogood on it (nogood * 2 + which
+                                                    // of its two watched literals), -1 for none. See Nogood::next
+    size_t nogood_head                        = 0;  // trail entries already propagated to the nogoods
+    size_t max_nogoods                        = 0;  // capacity of the store
+
+    // scratch of the search, sized once by scheduler() so that searching allocates nothing
+    std::vector<int> level_stack              = {}; // levels of the failures below the search nodes, see Levels
+    std::vector<unsigned> seen                = {}; // trail index -> last analysis visiting it
+    unsigned analysis                         = 0;  // conflict analyses so far, stamping seen
+
+    // symmetry breaking, set up by scheduler() with SearchOptions::symmetry. Interchangeable workers are chained,
+    // the days on duty of each one coming lexicographically no later than those of the next one
+    std::vector<int> symmetric_prev           = {}; // worker -> previous interchangeable worker, -1 for none
+    std::vector<int> symmetric_next           = {}; // worker -> next interchangeable worker, -1 for none
+
+    // soft preferences, weighting the cost of a schedule:
+    // each day worked despite a day-off request, the square of the weekend days each worker works
+    // (so that they are shared fairly), and each worker on duty beyond the minimum daily staff
+    int request_weight      = 1;
+    int weekend_weight      = 1;
+    int excess_weight       = 1;
+    // counters of the cost, updated with the domains. See recount_cost()
+    std::vector<int> on_duty                  = std::vector<int>(7); // day -> workers decided on duty
+    std::vector<int> weekend_duty             = {}; // worker -> weekend days decided on duty
+    long long cost                            = 0;  // cost of the days decided on duty so far, a lower bound
+                                                    // of the cost of any schedule extending them
+
+    int weeks               = 1; // length of the horizon, see set_weeks()
+
     // constraints with default values
-    int min_days_off        = 2; // minimum number of days off
-    int max_consec_days_off = 3; // maximum number of consecutive days off
+    int min_days_off        = 2; // minimum number of days off per week
+    int max_consec_days_off = 3; // maximum number of consecutive days off, across weeks too
     int min_daily_staff     = 3; // minimum number of daily staff required
     int min_daily_seniors   = 1; // minimum number of daily seniors required
 
-    std::string to_string();
+    int days() const { return 7 * weeks; }
+    Days all_days() const { return day_bit(days()) - 1; }
+
+    /// change the number of weeks to schedule, between 1 and MAX_WEEKS.
+    /// Every worker gets back all his options for every day.
+    void set_weeks(int weeks);
+
+    /// add a worker (or update its level) and return its index
+    int add_worker(const std::string& id, const std::string& level);
+    /// declare that the given workers cannot work together the same day. Unknown ids are ignored.
+    void add_conflict(const std::vector<std::string>& ids);
+    /// declare conflict groups of worker indices, each a clique. Indexing them is linear in the total size
+    /// of the groups, so add them all at once when there are many
+    void add_conflicts(const std::vector<std::vector<int>>& groups);
+    int clique_count() const { return clique_start.size() - 1; }
+    IndexRange cliques(int worker) const {
+        return { worker_cliques.data() + worker_start[worker], worker_cliques.data() + worker_start[worker + 1] };
+    }
+    IndexRange members(int clique) const {
+        return { clique_members.data() + clique_start[clique], clique_members.data() + clique_start[clique + 1] };
+    }
+    /// return the workers the worker conflicts with, in index order
+    std::vector<int> conflicting(int worker) const;
+    /// force the worker on (or off) duty the given day, from 0. The other option is removed as a fact
+    void pin(int worker, int day, bool on_duty);
+    /// decide the days that are not freed (worker -> days) as in the assignment (worker -> days on duty), removing
+    /// the other options, and propagate. Returns false when that breaks a constraint. See lns_scheduler(), repair()
+    bool fix_assignment(const std::vector<Days>& assignment, const std::vector<Days>& freed);
+    /// record that the worker would rather be off duty the given day, from 1. Unknown ids are ignored.
+    void add_request_off(const std::string& id, int day);
 
-    /// return the number of days is woking or not working, given the on or off array
-    static int count(std::unordered_set<std::string> arr[7], std::string id);
+    /// recompute the staff bound of each day from the domains
+    void recount_staff_bound();
+    /// recompute the cost counters from the domains
+    void recount_cost();
+    /// update the cost counters when the worker becomes (delta 1) or stops being (delta -1) on duty for the day
+    void count_on_duty(int worker, int day, int delta);
+
+    /// remove the on (or off) duty option of the worker for the given day, record it on the trail
+    /// and queue the constraints watching it
+    void remove(int worker, int day, bool on_duty);
+    /// queue a constraint instance unless it is already queued
+    void enqueue(ConstraintType type, int worker, int day);
+    /// empty the propagation queue
+    void clear_queue();
+    /// make room for n constraints in the propagation queue
+    void reserve_queue(size_t n);
+    /// restore the domain values removed since the trail had the given size
+    void undo(size_t mark);
+
+    /// fill the heap with the workers that have undecided days, or only those of the given workers
+    void build_heap(unsigned seed = 0, const std::vector<int>* only = nullptr);
+    /// chain the workers that can be swapped in any schedule: same level, same requests, same domain
+    /// and no conflict. See symmetric_next
+    void chain_symmetries();
+    bool symmetric(int worker) const {
+        return !symmetric_next.empty() && (symmetric_prev[worker] != -1 || symmetric_next[worker] != -1);
+    }
+    /// number of schedules a solved schedule stands for when the chains are set up: the distinct orders of the rows
+    /// of each chain of interchangeable workers, 1 without chains. LLONG_MAX when there are more
+    long long symmetric_count() const;
+    /// MRV priority of the worker: fewest undecided days first, then most conflicts
+    uint64_t priority(int worker) const;
+
+    /// literal of the removal of the on (or off) duty option of the worker for the given day
+    int literal(int worker, int day, bool on_duty) const { return (worker * days() + day) * 2 + on_duty; }
+    bool removed(int literal) const {
+        const Domain& domain = workers[literal / 2 / days()].domain;
+        return !((literal & 1 ? domain.on : domain.off) >> (literal / 2 % days()) & 1);
+    }
+    /// search level of the removal at the given trail index, 0 when it holds whatever the decisions
+    int level(size_t index) const {
+        return std::upper_bound(decisions.begin(), decisions.end(), index) - decisions.begin();
+    }
+    /// store a nogood of at most MAX_NOGOOD_SIZE literals, forgetting the older half of the store when it is full
+    void add_nogood(IndexRange literals);
+    /// forget every nogood
+    void clear_nogoods();
+
+    bool is_on(int worker, int day)  const { return (workers[worker].domain.on  & ~workers[worker].domain.off) >> day & 1; }
+    bool is_off(int worker, int day) const { return (workers[worker].domain.off & ~workers[worker].domain.on)  >> day & 1; }
+
+    /// write the schedule one week at a time, each week preceded by its number when there are several
+    void write(std::ostream& out);
+    std::string to_string();
 };
 
 struct Constraint {
     /// Checks if the constraints are satisfied.
-    static bool check                         ( Schedule& schedule, std::string worker_id, int day );
-    /// Propagate the constraints and forward check the other workers new states. 
-    static bool propagate                     ( Schedule& schedule, std::string worker_id, int day );
-    
-    static bool check_min_days_off            ( Schedule& schedule, std::string worker_id          );
-    static bool check_max_consec_days_off     ( Schedule& schedule, std::string worker_id          );
-    static bool check_min_daily_staff         ( Schedule& schedule, std::string worker_id, int day );
-    static bool check_conflicts               ( Schedule& schedule, std::string worker_id, int day );
-    static bool propagate_min_days_off        ( Schedule& schedule, std::string worker_id          );
-    static bool propagate_max_consec_days_off ( Schedule& schedule, std::string worker_id          );
-    static bool propagate_min_daily_staff     ( Schedule& schedule, std::string worker_id, int day );
-    static bool propagate_conflicts           ( Schedule& schedule, std::string worker_id, int day );
+    static bool check                         ( Schedule& schedule, int worker, int day );
+    /// Propagate the queued constraints until no more value can be removed,
+    /// forward checking the new states of the workers. The queue is empty afterwards.
+    static bool propagate                     ( Schedule& schedule );
+    /// Queue every constraint and propagate them.
+    static bool propagate_all                 ( Schedule& schedule );
+
+    static bool check_min_days_off            ( Schedule& schedule, int worker          );
+    static bool check_max_consec_days_off     ( Schedule& schedule, int worker          );
+    static bool check_min_daily_staff         ( Schedule& schedule, int worker, int day );
+    static bool check_conflicts               ( Schedule& schedule, int worker, int day );
+    static bool propagate_min_days_off        ( Schedule& schedule, int worker          );
+    static bool propagate_max_consec_days_off ( Schedule& schedule, int worker          );
+    static bool propagate_min_daily_staff     ( Schedule& schedule, int worker, int day );
+    static bool propagate_conflicts           ( Schedule& schedule, int worker, int day );
+    static bool propagate_symmetry            ( Schedule& schedule, int worker          );
+    /// Keep the values of the worker used by a sequence of week patterns satisfying both row constraints.
+    static bool propagate_patterns            ( Schedule& schedule, int worker          );
+    /// Visit the nogoods watching the literal, which just became true.
+    static bool propagate_nogoods             ( Schedule& schedule, int literal );
+
+    /// Append the trail indices of the earlier removals that caused the removal at the given index.
+    static void explain                       ( Schedule& schedule, size_t index, std::vector<int>& out );
+    /// Fill schedule.conflict with the removals that made check() fail for the worker and day.
+    static void explain_failure               ( Schedule& schedule, int worker, int day );
+
+    /// Remove a value from the worker domain and forward check his new state.
+    static bool prune                         ( Schedule& schedule, int worker, int day, bool on_duty );
+};
+
+/// Deepest node of a search that ran out of budget without a schedule, see SearchOptions::partial
+struct Partial {
+    long long decided = 0;          // days decided there, of workers * days
+    int worker = -1, day = -1;      // the next day to decide, -1 when every day is
+    int blocking_on = -1;           // ConstraintType failing the worker on duty that day, -1 when none does
+    int blocking_off = -1;          // ConstraintType failing him off duty
+};
+
+/// Search settings
+struct SearchOptions {
+    int threads              = 1;       // number of search threads
+    bool portfolio           = false;   // race differently seeded searches instead of splitting the search tree
+    unsigned seed            = 0;       // 0 keeps the default heuristics, otherwise ties and value order are seeded
+    std::atomic<bool>* stop  = nullptr; // when set, the search gives up as soon as possible
+    std::atomic<bool>* outer_stop = nullptr; // another flag like stop, for a search stopping itself that its caller
+                                        // can stop too
+    Stats* stats             = nullptr; // when set, the search statistics are added to it
+    bool backjump            = true;    // jump back to the decisions causing a failure, learning nogoods
+    int nogoods              = 1000;    // capacity of the nogood store, 0 to learn none
+    bool optimize            = false;   // search for the schedule of least cost instead of the first one (single threaded)
+    long long time_limit     = 0;       // milliseconds before the search gives up, an optimizing one settling for its best schedule,
+                                        // 0 for none
+    long long node_limit     = 0;       // search nodes before giving up likewise (per thread with threads), 0 for none
+    long long cost_limit     = LLONG_MAX; // an optimizing search only looks for schedules cheaper than this
+    bool* complete           = nullptr; // when set, tells whether the search ran to the end, proving its result optimal,
+                                        // or that there is no solution
+    Partial* partial         = nullptr; // when set and the search gives up without a schedule, the schedule is left
+                                        // in the deepest node reached, described here (single threaded searches only)
+    long long lns            = 0;       // milliseconds of large neighborhood search, 0 for an exact search
+    bool symmetry            = false;   // search one schedule per order of the interchangeable workers
+    bool patterns            = false;   // propagate the row constraints together, over the patterns of each week
+    const std::vector<Days>* warm_start = nullptr; // worker -> days on duty, the value tried first for each day
+    long long solutions      = 0;       // enumerate up to that many schedules instead of stopping at the first one,
+                                        // LLONG_MAX for all of them, 0 to stop at the first one (not when optimizing)
+    std::function<void(Schedule&, long long)> on_solution; // called with each improving schedule and its cost,
+                                        // or each schedule enumerated
 };
 
-/// Return the worker that have a non-zero but least number of available options in his domain.
-/// When the returned worker domain is empty, it means that all the workers domain are empty too.
-std::string mrv(std::unordered_map<std::string, Worker>& workers);
+/// Return the worker that have a non-zero but least number of available options in his domain,
+/// breaking ties by the number of workers he has conflicts with.
+/// When no worker has options left, return -1: every day of every worker is decided.
+/// Takes the top of schedule.heap, which must have been built.
+int mrv(Schedule& schedule);
 
 /// solve scheduling problem using MRV, Forward Checking, and Constriant Propagation to optimize the solution
-bool scheduler(Schedule& schedule);
+/// When enumerating (see SearchOptions::solutions), each schedule is passed to on_solution as it is found, without
+/// being kept: the schedule is left as propagated before searching, and the result tells whether there was one.
+/// With SearchOptions::symmetry, only one order of the interchangeable workers is enumerated, see symmetric_count().
+/// options.complete then tells whether every schedule was.
+bool scheduler(Schedule& schedule, const SearchOptions& options = {});
 
 /// Reads the input file and creates the schedule.
+/// The file is memory mapped and parsed in a single pass. Errors throw a std::runtime_error with the line number.
 /// file format:
 ///               worker_id level
 ///               worker_id level
@@ -85,12 +435,17 @@ bool scheduler(Schedule& schedule);
 ///               -constraint-name value1 value2 ...
 ///               ...
 ///
-/// The constraints are: 
+/// The constraints are:
 ///                 -conflict worker_id1 worker_id2 ...
 ///                 -min-days-off value
 ///                 -max-consec-days-off value
 ///                 -min-daily-staff value
 ///                 -min-daily-seniors value
+///                 -weeks value
+///                 -request-off worker_id day1 day2 ...
+///                 -weight-requests value
+///                 -weight-weekends value
+///                 -weight-excess value
 Schedule load_file(std::string filename);
 
 #endif // SCHEDULER_H
\ No newline at end of file
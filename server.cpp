@@ -0,0 +1,322 @@
+#include "server.h"
+#include "repair.h"
+#include "backend.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// A line read, waiting for its roster to be free
+struct Request {
+    long long number;               // from 1, in the order of the lines
+    std::vector<std::string> words; // command, roster name, arguments
+};
+
+/// A roster kept in memory, with the requests about it
+struct Roster {
+    bool loaded = false;
+    Schedule model;                           // the roster with every change, every day undecided but the pinned ones
+    std::shared_ptr<const Schedule> solution; // last schedule found, before the pending changes
+    std::vector<Change> pending;              // changes made since that schedule
+    std::deque<Request> requests;             // requests read, answered one at a time in this order
+    bool ready = false;                       // the roster is in the ready queue or taken by a thread
+};
+
+/// Outcome of a solve
+struct Answer {
+    bool solved = false;
+    bool complete = false;                    // the search ran to the end
+    long long cost = 0;
+    std::string rows;                         // the schedule, as written by Schedule::write()
+    std::shared_ptr<const Schedule> solution; // the schedule itself, to repair when the roster changes
+};
+
+/// Answers of the last rosters solved, by hash of the roster, the least recently used one dropped first.
+/// Only the answers that don't depend on the limits are kept: the schedules, and the proofs of no schedule.
+struct Cache {
+    std::mutex mutex;
+    size_t capacity = 0;
+    std::list<uint64_t> order; // most recently used first
+    std::unordered_map<uint64_t, std::pair<Answer, std::list<uint64_t>::iterator>> answers;
+
+    bool find(uint64_t key, Answer& answer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = answers.find(key);
+        if (it == answers.end())
+            return false;
+        order.splice(order.begin(), order, it->second.second);
+        answer = it->second.first;
+        return true;
+    }
+
+    void insert(uint64_t key, const Answer& answer) {
+        if (capacity == 0)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = answers.find(key);
+        if (it != answers.end()) {
+            it->second.first = answer;
+            order.splice(order.begin(), order, it->second.second);
+            return;
+        }
+        if (answers.size() == capacity) {
+            answers.erase(order.back());
+            order.pop_back();
+        }
+        order.push_front(key);
+        answers.emplace(key, std::make_pair(answer, order.begin()));
+    }
+};
+
+/// The rosters, and the rosters having requests, each taken by one thread at a time
+struct Server {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::unordered_map<std::string, std::shared_ptr<Roster>> rosters;
+    std::deque<std::shared_ptr<Roster>> ready;
+    int busy = 0;        // threads answering a request
+    bool closed = false; // no more requests will be read
+
+    std::mutex output;
+    std::ostream* out = nullptr;
+    Cache cache;
+    std::string backend;
+    SearchOptions options;
+};
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    // splitmix64 of the value, combined with the hash so far
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return (hash ^ value) * 0x100000001b3ULL;
+}
+
+static uint64_t mix(uint64_t hash, Days days) {
+    return mix(mix(hash, (uint64_t)days), (uint64_t)(days >> 64));
+}
+
+/// hash of the constraints of a roster: the same for the same workers in the same order,
+/// with the same constraints and preferences, whatever the order of the conflict groups
+static uint64_t roster_hash(const Schedule& schedule) {
+    uint64_t hash = 0;
+    for (int value : { schedule.weeks, schedule.min_days_off, schedule.max_consec_days_off, schedule.min_daily_staff,
+                       schedule.min_daily_seniors, schedule.request_weight, schedule.weekend_weight,
+                       schedule.excess_weight })
+        hash = mix(hash, (uint64_t)value);
+    std::hash<std::string> text;
+    for (auto& worker : schedule.workers) {
+        hash = mix(mix(hash, (uint64_t)text(worker.id)), (uint64_t)text(worker.level));
+        hash = mix(mix(mix(hash, worker.requested_off), worker.pinned_on), worker.pinned_off);
+    }
+    uint64_t cliques = 0;
+    std::vector<int> members;
+    for (int c = 0; c < schedule.clique_count(); c++) {
+        members.assign(schedule.members(c).begin(), schedule.members(c).end());
+        std::sort(members.begin(), members.end());
+        uint64_t clique = 0;
+        for (int w : members)
+            clique = mix(clique, (uint64_t)w);
+        cliques += clique;
+    }
+    return mix(hash, cliques);
+}
+
+/// Solve the roster, or repair its last schedule with the pending changes, unless the cache knows the answer
+static void solve(Server& server, Roster& roster, bool repairing, std::ostream& answer_out) {
+    auto start_time = std::chrono::steady_clock::now();
+    uint64_t key = roster_hash(roster.model);
+    Answer answer;
+    bool cached = server.cache.find(key, answer);
+    if (!cached) {
+        Schedule schedule;
+        bool complete = true;
+        SearchOptions local = server.options;
+        local.complete = &complete;
+        if (repairing && roster.solution) {
+            schedule = *roster.solution;
+            answer.solved = repair(schedule, roster.pending, local);
+        }
+        else {
+            schedule = roster.model;
+            answer.solved = make_backend(server.backend)->solve(schedule, local);
+        }
+        answer.complete = complete;
+        if (answer.solved) {
+            answer.cost = schedule.cost;
+            std::ostringstream rows;
+            schedule.write(rows);
+            answer.rows = rows.str();
+            answer.solution = std::make_shared<const Schedule>(std::move(schedule));
+        }
+        // any schedule will do unless optimizing, when one found within the limits may not be the best
+        bool any = !server.options.optimize && server.options.lns == 0;
+        if (answer.solved ? any || complete : complete)
+            server.cache.insert(key, answer);
+    }
+    // the schedule to repair from now on, if any
+    roster.solution = answer.solution;
+    roster.pending.clear();
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    if (answer.solved)
+        answer_out << " solved";
+    else
+        answer_out << (answer.complete ? " no-solution" : " no-solution-within-limits");
+    if (answer.solved && (server.options.optimize || server.options.lns > 0))
+        answer_out << " cost " << answer.cost << (answer.complete ? " optimal" : "");
+    answer_out << (cached ? " cached" : "") << " " << duration << " ms\n" << answer.rows;
+}
+
+/// Answer a request about the roster, which no other thread touches meanwhile
+static void answer(Server& server, Roster& roster, const Request& request) {
+    std::ostringstream answer_out;
+    answer_out << request.number;
+    try {
+        auto& words = request.words;
+        const std::string& command = words[0];
+        if (command != "load" && command != "modify" && command != "solve" && command != "resolve" &&
+                command != "unload")
+            throw std::invalid_argument("unknown request " + command);
+        if (words.size() < 2)
+            throw std::invalid_argument("expected a roster name after " + command);
+        if (command == "load") {
+            if (words.size() != 3)
+                throw std::invalid_argument("expected load <name> <input_file>");
+            roster.model = load_file(words[2]);
+            roster.loaded = true;
+            roster.solution = nullptr;
+            roster.pending.clear();
+            answer_out << " loaded " << roster.model.workers.size() << " workers\n";
+        }
+        else if (!roster.loaded)
+            throw std::invalid_argument("no roster " + words[1]);
+        else if (command == "modify") {
+            std::string line;
+            for (size_t i = 2; i < words.size(); i++)
+                line += (i > 2 ? " " : "") + words[i];
+            Change change = parse_change(line);
+            roster.model = apply_changes(roster.model, { change });
+            if (roster.solution)
+                roster.pending.push_back(change);
+            answer_out << " modified\n";
+        }
+        else if (command == "solve" || command == "resolve")
+            solve(server, roster, command == "resolve", answer_out);
+        else {
+            roster.loaded = false;
+            roster.model = Schedule();
+            roster.solution = nullptr;
+            roster.pending.clear();
+            answer_out << " unloaded\n";
+        }
+    }
+    catch (const std::exception& e) {
+        answer_out.str("");
+        answer_out << request.number << " error " << e.what() << "\n";
+    }
+    answer_out << ".\n";
+
+    std::lock_guard<std::mutex> lock(server.output);
+    *server.out << answer_out.str() << std::flush;
+}
+
+/// Take the rosters having requests and answer one request of each at a time, until the input is closed and done
+static void work(Server& server) {
+    std::unique_lock<std::mutex> lock(server.mutex);
+    while (true) {
+        server.wake.wait(lock, [&]() { return !server.ready.empty() || (server.closed && server.busy == 0); });
+        if (server.ready.empty())
+            break;
+        std::shared_ptr<Roster> roster = server.ready.front();
+        server.ready.pop_front();
+        Request request = std::move(roster->requests.front());
+        roster->requests.pop_front();
+        server.busy++;
+
+        lock.unlock();
+        answer(server, *roster, request);
+        lock.lock();
+
+        server.busy--;
+        // the next request of the roster waits behind those of the other rosters
+        if (!roster->requests.empty())
+            server.ready.push_back(roster);
+        else {
+            roster->ready = false;
+            // unloaded, or never loaded, and nothing left to answer about it: forget the name
+            auto it = server.rosters.find(request.words[1]);
+            if (!roster->loaded && it != server.rosters.end() && it->second == roster)
+                server.rosters.erase(it);
+        }
+        server.wake.notify_all();
+    }
+    server.wake.notify_all();
+}
+
+void serve(std::istream& in, std::ostream& out, int jobs, size_t cache, const std::string& backend,
+           const SearchOptions& options) {
+    Server server;
+    server.out = &out;
+    server.cache.capacity = cache;
+    server.backend = backend;
+    // the requests are the parallelism: each search runs single threaded, reporting nothing
+    server.options = options;
+    server.options.threads = 1;
+    server.options.stats = nullptr;
+    server.options.partial = nullptr;
+    server.options.on_solution = nullptr;
+    server.options.solutions = 0;
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, jobs); t++)
+        pool.emplace_back([&]() { work(server); });
+
+    // read the requests while the threads answer the previous ones
+    std::string line;
+    for (long long number = 1; std::getline(in, line); number++) {
+        Request request { number, {} };
+        std::stringstream ss(line);
+        for (std::string word; ss >> word;)
+            request.words.push_back(word);
+        if (request.words.empty()) {
+            number--;
+            continue;
+        }
+        if (request.words[0] == "quit")
+            break;
+
+        // the requests about no roster, loaded or queued to load, are answered at once as errors, keeping no name
+        std::unique_lock<std::mutex> lock(server.mutex);
+        auto it = request.words.size() > 1 ? server.rosters.find(request.words[1]) : server.rosters.end();
+        if (it == server.rosters.end() && (request.words.size() < 2 || request.words[0] != "load")) {
+            lock.unlock();
+            Roster none;
+            answer(server, none, request);
+            continue;
+        }
+        if (it == server.rosters.end())
+            it = server.rosters.emplace(request.words[1], std::make_shared<Roster>()).first;
+        std::shared_ptr<Roster> roster = it->second;
+        roster->requests.push_back(std::move(request));
+        if (!roster->ready) {
+            roster->ready = true;
+            server.ready.push_back(roster);
+            server.wake.notify_one();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(server.mutex);
+        server.closed = true;
+    }
+    server.wake.notify_all();
+    for (auto& thread : pool)
+        thread.join();
+}
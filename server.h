@@ -0,0 +1,23 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <iostream>
+
+#include "scheduler.h"
+
+/// Answer the requests read from in, one per line, until quit or the end of the input:
+///               load <name> <input_file>   read a roster and keep it in memory under the name
+///               modify <name> <change>     change the roster, a change written like a line of a changes file
+///               solve <name>               solve the roster from scratch
+///               resolve <name>             repair the last schedule of the roster with the changes made since
+///               unload <name>              forget the roster
+///               quit
+/// Each answer is written to out as soon as it is ready: a line "<request number> <status> ...", from 1 in the
+/// order of the lines read, the schedule if any, and a line ".". The requests are solved by a pool of jobs threads,
+/// those of a roster in the order they were read and the others in parallel, each by a single threaded search of
+/// the named backend (see make_backend()). The outcomes of the solves are kept by a hash of the roster, for up to
+/// cache rosters, so that solving a roster that was solved already answers at once.
+void serve(std::istream& in, std::ostream& out, int jobs, size_t cache, const std::string& backend,
+           const SearchOptions& options);
+
+#endif // SERVER_H